@@ -0,0 +1,235 @@
+#include "black_span.h"
+#include "bsp_co5300.h"
+
+black_span_info_t *g_black_span_info;
+
+// Bit b set: block b of the row may show something other than black
+static uint32_t s_lit[BLACK_SPAN_MAX_ROWS];
+
+static void wait_flush(void)
+{
+    while (!*g_black_span_info->flush_done)
+    {
+        tight_loop_contents();
+    }
+}
+
+// Word-wise once aligned: frames are mostly long zero runs
+static bool is_black(const uint8_t *p, int n)
+{
+    while (n > 0 && ((uintptr_t)p & 3) != 0)
+    {
+        if (*p++ != 0)
+            return false;
+        n--;
+    }
+    const uint32_t *w = (const uint32_t *)p;
+    for (; n >= 4; n -= 4)
+    {
+        if (*w++ != 0)
+            return false;
+    }
+    p = (const uint8_t *)w;
+    while (n-- > 0)
+    {
+        if (*p++ != 0)
+            return false;
+    }
+    return true;
+}
+
+void black_span_init(black_span_info_t *span_info)
+{
+    g_black_span_info = span_info;
+    if (span_info->height > BLACK_SPAN_MAX_ROWS)
+        span_info->height = BLACK_SPAN_MAX_ROWS;
+    span_info->block_width = (span_info->width + BLACK_SPAN_BLOCKS - 1) / BLACK_SPAN_BLOCKS;
+
+    black_span_forget();
+    black_span_reset_stats();
+}
+
+black_span_info_t *black_span_get_info(void)
+{
+    return g_black_span_info;
+}
+
+void black_span_forget(void)
+{
+    memset(s_lit, 0xFF, sizeof(s_lit));
+}
+
+void black_span_mark(int y, const uint8_t *pixels, int x_start, int x_end)
+{
+    black_span_info_t *info = g_black_span_info;
+    int block_width = info->block_width;
+    uint32_t lit = s_lit[y];
+    for (int b = x_start / block_width; b * block_width < x_end; b++)
+    {
+        uint32_t bit = 1u << b;
+        int block_end = (b + 1) * block_width < info->width ? (b + 1) * block_width : info->width;
+        int x0 = b * block_width > x_start ? b * block_width : x_start;
+        int x1 = block_end < x_end ? block_end : x_end;
+        if (pixels == NULL || !is_black(&pixels[x0 - x_start], x1 - x0))
+        {
+            lit |= bit;
+        }
+        else if (x0 == b * block_width && x1 == block_end)
+        {
+            lit &= ~bit; // All of the block was sent black
+        }
+    }
+    s_lit[y] = lit;
+}
+
+void black_span_reset_stats(void)
+{
+    black_span_info_t *info = g_black_span_info;
+    info->rows = 0;
+    info->rows_skipped = 0;
+    info->bursts = 0;
+    info->bytes_sent = 0;
+    info->bytes_skipped = 0;
+    info->scan_us = 0;
+}
+
+uint16_t black_span_calibrate(void)
+{
+    black_span_info_t *info = g_black_span_info;
+    uint8_t *zeros = calloc(info->width, 1);
+    if (zeros == NULL)
+    {
+        printf("Black span: no RAM for the calibration line\n");
+        return info->window_cost;
+    }
+
+    uint32_t t0 = time_us_32();
+    for (int i = 0; i < BLACK_SPAN_BENCH_REPEATS; i++)
+    {
+        bsp_co5300_set_window(0, 0, info->width - 1, 0);
+    }
+    uint32_t window_us = time_us_32() - t0;
+
+    // Flush time is burst_ns + bytes * byte_ps: fit it from a 1-byte and a full-row flush
+    uint32_t lengths[2] = {1, info->width};
+    uint32_t flush_us[2];
+    for (int k = 0; k < 2; k++)
+    {
+        t0 = time_us_32();
+        for (int i = 0; i < BLACK_SPAN_BENCH_REPEATS; i++)
+        {
+            *info->flush_done = false;
+            bsp_co5300_flush(zeros, lengths[k]);
+            wait_flush();
+        }
+        flush_us[k] = time_us_32() - t0;
+    }
+    free(zeros);
+
+    uint32_t short_ns = flush_us[0] * 1000 / BLACK_SPAN_BENCH_REPEATS;
+    uint32_t long_ns = flush_us[1] * 1000 / BLACK_SPAN_BENCH_REPEATS;
+    info->window_ns = window_us * 1000 / BLACK_SPAN_BENCH_REPEATS;
+    if (long_ns > short_ns)
+    {
+        info->byte_ps = (long_ns - short_ns) * 1000 / (lengths[1] - lengths[0]);
+    }
+    if (info->byte_ps == 0)
+    {
+        return info->window_cost; // Timer too coarse; keep the preset
+    }
+    info->burst_ns = short_ns > info->byte_ps / 1000 ? short_ns - info->byte_ps / 1000 : 0;
+
+    uint32_t cost = (uint64_t)(info->window_ns + info->burst_ns) * 1000 / info->byte_ps;
+    if (cost < 1)
+        cost = 1;
+    if (cost > info->width)
+        cost = info->width;
+    info->window_cost = cost;
+    return info->window_cost;
+}
+
+int black_span_plan(int y, const uint8_t *line, int x_start, int x_end, black_span_burst_t *bursts)
+{
+    black_span_info_t *info = g_black_span_info;
+    uint32_t t0 = time_us_32();
+    int block_width = info->block_width;
+    int first_block = x_start / block_width;
+    int end_block = (x_end + block_width - 1) / block_width;
+
+    uint32_t lit = s_lit[y];
+    uint32_t range = 0;
+    uint32_t now_lit = 0;
+    uint32_t skippable = 0; // Black now and black on the panel
+    for (int b = first_block; b < end_block; b++)
+    {
+        uint32_t bit = 1u << b;
+        int x0 = b * block_width > x_start ? b * block_width : x_start;
+        int x1 = (b + 1) * block_width < x_end ? (b + 1) * block_width : x_end;
+        range |= bit;
+        if (!is_black(&line[x0], x1 - x0))
+        {
+            now_lit |= bit;
+        }
+        else if ((lit & bit) == 0)
+        {
+            skippable |= bit;
+        }
+    }
+    // Sent blocks now show exactly what they hold; skipped ones stay black
+    s_lit[y] = (lit & ~range) | now_lit;
+
+    // Cut out runs of skippable blocks that are worth a burst of their own
+    int count = 0;
+    int send_from = x_start;
+    for (int b = first_block; b < end_block;)
+    {
+        if ((skippable & (1u << b)) == 0)
+        {
+            b++;
+            continue;
+        }
+        int run_end = b;
+        while (run_end < end_block && (skippable & (1u << run_end)) != 0)
+        {
+            run_end++;
+        }
+        int x0 = b * block_width > x_start ? b * block_width : x_start;
+        int x1 = run_end * block_width < x_end ? run_end * block_width : x_end;
+        if (x1 - x0 > info->window_cost)
+        {
+            if (x0 > send_from)
+            {
+                bursts[count].x_start = send_from;
+                bursts[count].x_end = x0;
+                count++;
+            }
+            send_from = x1;
+        }
+        b = run_end;
+    }
+    if (send_from < x_end)
+    {
+        bursts[count].x_start = send_from;
+        bursts[count].x_end = x_end;
+        count++;
+    }
+
+    uint32_t sent = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sent += bursts[i].x_end - bursts[i].x_start;
+    }
+    info->rows++;
+    if (count == 0)
+    {
+        info->rows_skipped++;
+    }
+    else
+    {
+        info->bursts += count - 1;
+    }
+    info->bytes_sent += sent;
+    info->bytes_skipped += (x_end - x_start) - sent;
+    info->scan_us += time_us_32() - t0;
+    return count;
+}
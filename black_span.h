@@ -0,0 +1,72 @@
+#ifndef __BLACK_SPAN_H__
+#define __BLACK_SPAN_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define BLACK_SPAN_MAX_ROWS 480
+#define BLACK_SPAN_BLOCKS 32                          // Panel state per row: one bit per block of columns
+#define BLACK_SPAN_MAX_BURSTS (BLACK_SPAN_BLOCKS / 2 + 1) // Sent runs alternate with skipped ones
+#define BLACK_SPAN_BENCH_REPEATS 64
+
+// Columns [x_start, x_end) of a row, sent under their own single-row window
+typedef struct
+{
+    uint16_t x_start;
+    uint16_t x_end;
+} black_span_burst_t;
+
+typedef struct
+{
+    uint16_t width;             // Panel size
+    uint16_t height;
+    uint16_t window_cost;       // Pixel bytes one extra burst costs; black_span_calibrate() measures it
+    volatile bool *flush_done;  // Set by the display DMA completion callback
+
+    // Computed by black_span_init() / black_span_calibrate()
+    uint16_t block_width;  // Columns per state bit and skip granularity
+    uint32_t window_ns;    // One set_window
+    uint32_t burst_ns;     // Fixed cost of one flush, on top of its bytes
+    uint32_t byte_ps;      // One pixel byte on the display bus
+
+    // Statistics since the last black_span_reset_stats()
+    uint32_t rows;
+    uint32_t rows_skipped;   // Rows not sent at all
+    uint32_t bursts;         // Extra bursts from rows split around black runs
+    uint32_t bytes_sent;
+    uint32_t bytes_skipped;
+    uint32_t scan_us;
+} black_span_info_t;
+
+// Sizes the blocks and marks the whole panel as unknown (lit), so the first
+// frame is sent in full.
+void black_span_init(black_span_info_t *span_info);
+black_span_info_t *black_span_get_info(void);
+
+// Times set_window and short/long flushes (black, to row 0) and sets
+// window_cost to (set_window + per-flush overhead) / time per byte. The display
+// DMA must be idle. Returns the new window_cost.
+uint16_t black_span_calibrate(void);
+
+// Splits columns [x_start, x_end) of row y into the bursts to send. A block is
+// skipped when it is black in `line` and the panel is known to show black
+// there already; a run of such blocks is only cut out when it is longer than
+// window_cost. Records what the panel will show once the bursts are sent.
+// Returns the number of bursts: 0 for a skipped row, 1 with the full range
+// for a row sent whole.
+int black_span_plan(int y, const uint8_t *line, int x_start, int x_end, black_span_burst_t *bursts);
+
+// Records that columns [x_start, x_end) of row y were sent by another path
+// (pixels[0] is column x_start). Blocks it covered whole now show what it sent;
+// blocks it touched turn lit if what it sent there isn't black. NULL pixels,
+// content unknown here: every touched block turns lit.
+void black_span_mark(int y, const uint8_t *pixels, int x_start, int x_end);
+
+// Panel content was changed behind our back: treat every pixel as lit again
+void black_span_forget(void);
+
+void black_span_reset_stats(void);
+
+#endif // __BLACK_SPAN_H__
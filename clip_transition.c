@@ -0,0 +1,256 @@
+#include "clip_transition.h"
+#include "pixel_kernels.h"
+
+clip_transition_info_t *g_clip_transition_info;
+
+static uint16_t s_tail[PLAYLIST_MAX_CLIPS]; // Crossfade frames at the end of each clip, into the next one
+static uint16_t s_clip_count;              // 0 when transitions are off
+
+static uint32_t s_line_words[CLIP_TRANSITION_MAX_WIDTH / 4]; // Blended row, word-aligned for the kernel
+
+static clip_transition_report_t s_report; // The crossfade being measured
+static bool s_report_open;
+static clip_transition_report_t s_log[CLIP_TRANSITION_REPORT_LOG];
+static uint8_t s_log_head;
+static uint8_t s_log_count;
+
+static int next_clip(int clip)
+{
+    return (clip + 1) % s_clip_count;
+}
+
+// Frames of clip that were already shown, blended into the previous clip's tail
+static int head_frames(int clip)
+{
+    return s_tail[(clip + s_clip_count - 1) % s_clip_count];
+}
+
+// The clip whose tail frame_index is in, or -1
+static int tail_clip(int frame_index)
+{
+    if (s_clip_count == 0)
+        return -1;
+    int clip = playlist_clip_of(frame_index);
+    const playlist_clip_t *entry = playlist_get_clip(clip);
+    if (entry == NULL || s_tail[clip] == 0)
+        return -1;
+    int tail_start = entry->first_frame + entry->frame_count - s_tail[clip];
+    return frame_index >= tail_start ? clip : -1;
+}
+
+bool clip_transition_init(clip_transition_info_t *transition_info)
+{
+    g_clip_transition_info = transition_info;
+    clip_transition_info_t *info = transition_info;
+    s_clip_count = 0;
+    s_report_open = false;
+    s_log_head = 0;
+    s_log_count = 0;
+    clip_transition_reset_stats();
+
+    int clip_count = playlist_get_info()->clip_count;
+    if (info->frames == 0 || clip_count < 2)
+    {
+        return false;
+    }
+    if (info->width > CLIP_TRANSITION_MAX_WIDTH)
+    {
+        printf("Clip transition: %u-pixel rows exceed %d\n", info->width, CLIP_TRANSITION_MAX_WIDTH);
+        return false;
+    }
+
+    // Each clip gives at most half its frames to either end, so a head never runs into a tail
+    for (int clip = 0; clip < clip_count; clip++)
+    {
+        int frames = info->frames;
+        int outgoing_half = playlist_get_clip(clip)->frame_count / 2;
+        int incoming_half = playlist_get_clip((clip + 1) % clip_count)->frame_count / 2;
+        if (frames > outgoing_half)
+            frames = outgoing_half;
+        if (frames > incoming_half)
+            frames = incoming_half;
+        s_tail[clip] = frames;
+    }
+    s_clip_count = clip_count;
+    return true;
+}
+
+clip_transition_info_t *clip_transition_get_info(void)
+{
+    return g_clip_transition_info;
+}
+
+void clip_transition_reset_stats(void)
+{
+    clip_transition_info_t *info = g_clip_transition_info;
+    info->rows_blended = 0;
+    info->rows_unblended = 0;
+    info->blend_us = 0;
+    info->transitions = 0;
+    info->frames_over_deadline = 0;
+}
+
+int clip_transition_incoming(int frame_index, uint8_t *alpha)
+{
+    int clip = tail_clip(frame_index);
+    if (clip < 0)
+        return -1;
+    const playlist_clip_t *outgoing = playlist_get_clip(clip);
+    int n = s_tail[clip];
+    int k = frame_index - (outgoing->first_frame + outgoing->frame_count - n);
+    if (alpha != NULL)
+    {
+        // Never all of either clip: those are the frames just before and after the crossfade
+        *alpha = (k + 1) * PIXEL_KERNELS_ALPHA_MAX / (n + 1);
+    }
+    return playlist_get_clip(next_clip(clip))->first_frame + k;
+}
+
+int clip_transition_next(int frame_index)
+{
+    int total_frames = playlist_get_info()->frame_count;
+    if (s_clip_count == 0)
+        return (frame_index + 1) % total_frames;
+
+    int clip = playlist_clip_of(frame_index);
+    const playlist_clip_t *entry = playlist_get_clip(clip);
+    int next_frame = (frame_index + 1) % total_frames;
+    if (frame_index == entry->first_frame + entry->frame_count - 1 && s_tail[clip] > 0)
+    {
+        next_frame = playlist_get_clip(next_clip(clip))->first_frame + s_tail[clip];
+    }
+
+    // Bench: skip the middle of the clip so the transitions run back to back
+    int lead = g_clip_transition_info->bench_lead;
+    if (lead > 0)
+    {
+        int next = playlist_clip_of(next_frame);
+        const playlist_clip_t *next_entry = playlist_get_clip(next);
+        int tail_start = next_entry->first_frame + next_entry->frame_count - s_tail[next];
+        if (next_frame == next_entry->first_frame + head_frames(next) && s_tail[next] > 0 &&
+            tail_start - lead > next_frame)
+        {
+            next_frame = tail_start - lead;
+        }
+    }
+    return next_frame;
+}
+
+uint16_t clip_transition_min_depth(int frame_index)
+{
+    if (s_clip_count == 0)
+        return 0;
+    int clip = playlist_clip_of(frame_index);
+    const playlist_clip_t *entry = playlist_get_clip(clip);
+    int n = s_tail[clip];
+    int tail_start = entry->first_frame + entry->frame_count - n;
+    // The window has to reach n frames past the one due next, and needs about n frames at two
+    // loads per frame to get there before the tail starts
+    if (n > 0 && frame_index >= tail_start - (n + 1))
+        return n + 1;
+    return 0;
+}
+
+const uint8_t *clip_transition_get_row(int frame_index, uint16_t row)
+{
+    clip_transition_info_t *info = g_clip_transition_info;
+    uint8_t alpha;
+    int incoming = clip_transition_incoming(frame_index, &alpha);
+    const uint8_t *src = info->get_row(frame_index, row);
+    if (incoming < 0 || src == NULL)
+    {
+        return src;
+    }
+
+    uint32_t t0 = time_us_32();
+    uint8_t *line = (uint8_t *)s_line_words;
+    memcpy(line, src, info->width); // The next get_row may decode into the buffer src points to
+    const uint8_t *blend_src = info->get_row(incoming, row);
+    if (blend_src == NULL)
+    {
+        info->rows_unblended++;
+    }
+    else
+    {
+        pixel_kernels_blend332(line, line, blend_src, info->width, alpha);
+        info->rows_blended++;
+    }
+    info->blend_us += time_us_32() - t0;
+    return line;
+}
+
+static void log_report(void)
+{
+    s_log[(s_log_head + s_log_count) % CLIP_TRANSITION_REPORT_LOG] = s_report;
+    if (s_log_count < CLIP_TRANSITION_REPORT_LOG)
+    {
+        s_log_count++;
+    }
+    else
+    {
+        s_log_head = (s_log_head + 1) % CLIP_TRANSITION_REPORT_LOG; // Overwrite the oldest
+    }
+    g_clip_transition_info->transitions++;
+    s_report_open = false;
+}
+
+// The report frame_index belongs to, after logging the one it ends; NULL outside a tail
+static clip_transition_report_t *report_of(int frame_index)
+{
+    int clip = tail_clip(frame_index);
+    if (s_report_open && s_report.from_clip != clip)
+    {
+        log_report();
+    }
+    if (clip < 0)
+    {
+        return NULL;
+    }
+    if (!s_report_open)
+    {
+        memset(&s_report, 0, sizeof(s_report));
+        s_report.from_clip = clip;
+        s_report.to_clip = next_clip(clip);
+        s_report_open = true;
+    }
+    return &s_report;
+}
+
+void clip_transition_end_frame(int frame_index, uint32_t frame_us, uint32_t deadline_us)
+{
+    clip_transition_report_t *report = report_of(frame_index);
+    if (report == NULL)
+    {
+        return;
+    }
+    report->frames++;
+    if (deadline_us != 0 && frame_us > deadline_us)
+    {
+        report->over_deadline++;
+        g_clip_transition_info->frames_over_deadline++;
+    }
+    if (frame_us >= report->max_frame_us)
+    {
+        report->max_frame_us = frame_us;
+        report->deadline_us = deadline_us;
+    }
+}
+
+void clip_transition_drop_frame(int frame_index)
+{
+    clip_transition_report_t *report = report_of(frame_index);
+    if (report != NULL)
+    {
+        report->dropped++;
+    }
+}
+
+bool clip_transition_pop_report(clip_transition_report_t *report)
+{
+    if (s_log_count == 0)
+        return false;
+    *report = s_log[s_log_head];
+    s_log_head = (s_log_head + 1) % CLIP_TRANSITION_REPORT_LOG;
+    s_log_count--;
+    return true;
+}
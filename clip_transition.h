@@ -0,0 +1,77 @@
+#ifndef __CLIP_TRANSITION_H__
+#define __CLIP_TRANSITION_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "playlist.h"
+
+#define CLIP_TRANSITION_MAX_WIDTH 480 // Widest source row that can be blended
+#define CLIP_TRANSITION_REPORT_LOG 8  // Finished transitions kept for the host to drain
+
+typedef const uint8_t *(*clip_transition_get_row_t)(int frame_index, uint16_t row);
+
+// One finished crossfade, measured against the deadlines of its frames
+typedef struct
+{
+    uint16_t from_clip;
+    uint16_t to_clip;
+    uint16_t frames;        // Blended frames shown
+    uint16_t dropped;       // Blended frames the scheduler dropped
+    uint16_t over_deadline; // Shown frames whose work took longer than their deadline
+    uint32_t max_frame_us;  // Slowest shown frame
+    uint32_t deadline_us;   // That frame's deadline
+} clip_transition_report_t;
+
+typedef struct
+{
+    uint16_t frames;                   // Crossfade length; a boundary uses at most half of either clip
+    uint16_t width;                    // Source row bytes
+    uint16_t bench_lead;               // Nonzero: after each incoming head, jump to this many frames before the next tail
+    clip_transition_get_row_t get_row; // Rows of cached frames, NULL if the frame is not cached
+
+    // Statistics since the last clip_transition_reset_stats()
+    uint32_t rows_blended;
+    uint32_t rows_unblended; // The incoming row wasn't cached: the outgoing row was shown alone
+    uint32_t blend_us;       // Time spent fetching the incoming rows and blending
+    uint32_t transitions;    // Reports logged
+    uint32_t frames_over_deadline;
+} clip_transition_info_t;
+
+// Works out each clip boundary's crossfade from the playlist. The last
+// `frames` frames of every clip are blended with the first `frames` frames of
+// the next one (the first clip follows the last), which then plays on from
+// after its head. Returns false, with transitions off, if there are fewer
+// than two clips or frames is 0.
+bool clip_transition_init(clip_transition_info_t *transition_info);
+clip_transition_info_t *clip_transition_get_info(void);
+
+// The incoming frame blended into frame_index and its weight in 1/32
+// (PIXEL_KERNELS_ALPHA_MAX), or -1 if frame_index isn't in a clip's tail
+int clip_transition_incoming(int frame_index, uint8_t *alpha);
+
+// The frame shown after frame_index: past the incoming clip's head at the end
+// of a tail, which it was already blended into
+int clip_transition_next(int frame_index);
+
+// Look-ahead that keeps the incoming head loaded during a tail: from just
+// before the tail, the frame `frames` ahead is needed too. 0 elsewhere.
+uint16_t clip_transition_min_depth(int frame_index);
+
+// get_row for the compositor: a tail frame's rows are blended with the
+// incoming frame's. The row stays valid until the next call.
+const uint8_t *clip_transition_get_row(int frame_index, uint16_t row);
+
+// Reports the work a shown frame took (everything but waiting for its
+// presentation time) against its deadline, or that it was dropped. A report
+// is logged when a crossfade's last frame is followed by any other frame.
+void clip_transition_end_frame(int frame_index, uint32_t frame_us, uint32_t deadline_us);
+void clip_transition_drop_frame(int frame_index);
+
+// Pops the oldest finished crossfade. Returns false when the log is empty.
+bool clip_transition_pop_report(clip_transition_report_t *report);
+
+void clip_transition_reset_stats(void);
+
+#endif // __CLIP_TRANSITION_H__
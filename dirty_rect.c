@@ -0,0 +1,339 @@
+#include "dirty_rect.h"
+#include "bsp_co5300.h"
+#include "panel_mask.h"
+
+dirty_rect_info_t *g_dirty_rect_info;
+
+// One region buffer: rows are diffed against it as they are composed, so the changed
+// spans are copied in place instead of keeping a second, back buffer of the region
+static uint8_t *s_shown;  // What the panel shows, once the last present is out
+static uint8_t *s_line;   // The row being composed
+static uint16_t *s_span;  // Changed columns [s_span[2 * row], s_span[2 * row + 1]) since the last present
+static bool s_shown_valid;
+static bool s_writable;   // The last present's DMA is done reading s_shown
+static bsp_co5300_dma_block_t *s_chain; // One block per panel row plus the end marker
+
+static void wait_flush(void)
+{
+    while (!*g_dirty_rect_info->flush_done)
+    {
+        tight_loop_contents();
+    }
+}
+
+// Changed columns [*first, *end) of a row; word-wise while both rows are aligned
+static bool row_span(const uint8_t *a, const uint8_t *b, int n, int *first, int *end)
+{
+    bool aligned = (((uintptr_t)a | (uintptr_t)b) & 3) == 0;
+    int i = 0;
+    if (aligned)
+    {
+        while (i + 4 <= n && *(const uint32_t *)&a[i] == *(const uint32_t *)&b[i])
+            i += 4;
+    }
+    while (i < n && a[i] == b[i])
+        i++;
+    if (i == n)
+        return false;
+
+    int j = n;
+    while (j > i && (j & 3) != 0 && a[j - 1] == b[j - 1])
+        j--;
+    if (aligned && (j & 3) == 0)
+    {
+        while (j - 4 >= i && *(const uint32_t *)&a[j - 4] == *(const uint32_t *)&b[j - 4])
+            j -= 4;
+    }
+    while (j > i && a[j - 1] == b[j - 1])
+        j--;
+
+    *first = i;
+    *end = j;
+    return true;
+}
+
+static void clamp(dirty_rect_info_t *rect_info)
+{
+    if (rect_info->max_rects < 1 || rect_info->max_rects > DIRTY_RECT_MAX_RECTS)
+        rect_info->max_rects = DIRTY_RECT_MAX_RECTS;
+    if (rect_info->row_repeat < 1)
+        rect_info->row_repeat = 1;
+    if (rect_info->col_repeat < 1)
+        rect_info->col_repeat = 1;
+}
+
+static inline size_t word_align(size_t bytes)
+{
+    return (bytes + 3) & ~(size_t)3;
+}
+
+// The buffers' sizes, in the order they are carved from the pool
+static void buffer_sizes(const dirty_rect_info_t *rect_info, size_t sizes[4])
+{
+    sizes[0] = ((size_t)rect_info->height * rect_info->row_repeat + 1) * sizeof(bsp_co5300_dma_block_t); // s_chain
+    sizes[1] = word_align((size_t)rect_info->width * rect_info->height);                                  // s_shown
+    sizes[2] = word_align(rect_info->width);                                                              // s_line
+    sizes[3] = (size_t)rect_info->height * 2 * sizeof(uint16_t);                                          // s_span
+}
+
+size_t dirty_rect_pool_bytes(const dirty_rect_info_t *rect_info)
+{
+    dirty_rect_info_t clamped = *rect_info;
+    size_t sizes[4];
+    clamp(&clamped);
+    buffer_sizes(&clamped, sizes);
+    return sizes[0] + sizes[1] + sizes[2] + sizes[3];
+}
+
+bool dirty_rect_init(dirty_rect_info_t *rect_info)
+{
+    g_dirty_rect_info = rect_info;
+    clamp(rect_info);
+
+    size_t sizes[4];
+    buffer_sizes(rect_info, sizes);
+    if (rect_info->pool == NULL || rect_info->pool_size < dirty_rect_pool_bytes(rect_info))
+    {
+        printf("Dirty rect: a %ux%u region needs %u bytes, pool has %u\n", rect_info->width, rect_info->height,
+               (unsigned)dirty_rect_pool_bytes(rect_info), (unsigned)rect_info->pool_size);
+        return false;
+    }
+    uint8_t *next = rect_info->pool;
+    s_chain = (bsp_co5300_dma_block_t *)next;
+    next += sizes[0];
+    s_shown = next;
+    next += sizes[1];
+    s_line = next;
+    next += sizes[2];
+    s_span = (uint16_t *)next;
+
+    s_writable = true;
+    dirty_rect_invalidate();
+    dirty_rect_reset_stats();
+    return true;
+}
+
+dirty_rect_info_t *dirty_rect_get_info(void)
+{
+    return g_dirty_rect_info;
+}
+
+void dirty_rect_reset_stats(void)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    info->frames = 0;
+    info->full_frames = 0;
+    info->clean_frames = 0;
+    info->rects = 0;
+    info->bytes_sent = 0;
+    info->diff_us = 0;
+}
+
+void dirty_rect_invalidate(void)
+{
+    s_shown_valid = false;
+}
+
+uint8_t *dirty_rect_line(void)
+{
+    return s_line;
+}
+
+void dirty_rect_commit_row(int row)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    int width = info->width;
+    uint8_t *shown = &s_shown[row * width];
+    uint32_t t0 = time_us_32();
+
+    int first = 0;
+    int end = width;
+    if (s_shown_valid && !row_span(shown, s_line, width, &first, &end))
+    {
+        first = end = 0;
+    }
+    if (first < end)
+    {
+        if (!s_writable)
+        {
+            wait_flush();
+            s_writable = true;
+        }
+        memcpy(&shown[first], &s_line[first], end - first);
+    }
+    s_span[2 * row] = first;
+    s_span[2 * row + 1] = end;
+    info->diff_us += time_us_32() - t0;
+}
+
+int dirty_rect_diff(dirty_rect_t *rects)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    int width = info->width;
+    uint32_t scale = (uint32_t)info->row_repeat * info->col_repeat; // Panel bytes per buffer byte
+    int count = 0;
+    dirty_rect_t *rect = NULL;
+    uint32_t rect_dirty = 0; // Changed bytes inside the open rect
+    uint32_t sent = 0;
+
+    for (int y = 0; y < info->height; y++)
+    {
+        int first = s_span[2 * y];
+        int end = s_span[2 * y + 1];
+        if (first == end)
+        {
+            continue;
+        }
+
+        if (rect != NULL)
+        {
+            // Widening to the union span and taking in the clean rows since the rect's last row
+            int x_start = first < rect->x ? first : rect->x;
+            int x_end = end > rect->x + rect->width ? end : rect->x + rect->width;
+            int32_t waste_before = (int32_t)rect->height * rect->width - rect_dirty;
+            int32_t waste_after = (int32_t)(y + 1 - rect->y) * (x_end - x_start) - rect_dirty - (end - first);
+            if ((waste_after - waste_before) * (int32_t)scale <= info->window_cost)
+            {
+                rect->x = x_start;
+                rect->width = x_end - x_start;
+                rect->height = y + 1 - rect->y;
+                rect_dirty += end - first;
+                continue;
+            }
+            sent += (uint32_t)rect->width * rect->height;
+        }
+
+        if (count == info->max_rects)
+        {
+            return -1;
+        }
+        rect = &rects[count++];
+        rect->x = first;
+        rect->y = y;
+        rect->width = end - first;
+        rect->height = 1;
+        rect_dirty = end - first;
+    }
+    if (rect != NULL)
+    {
+        sent += (uint32_t)rect->width * rect->height;
+    }
+
+    // In panel bytes: every buffer byte goes out row_repeat * col_repeat times
+    uint32_t full = (uint32_t)width * info->height * scale;
+    if (count > 0 && sent * scale + (uint32_t)(count - 1) * info->window_cost >= full)
+    {
+        return -1;
+    }
+    return count;
+}
+
+// Sends buffer columns [col_start, col_end) to panel rows [row_start, row_end) under one
+// window, the region's top-left at panel (x, y)
+static void send_block(int col_start, int col_end, int row_start, int row_end, int x, int y)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    int width = info->width;
+    int repeat = info->row_repeat;
+    int col_repeat = info->col_repeat;
+    int cols = col_end - col_start;
+
+    wait_flush();
+    bsp_co5300_set_pixel_repeat(col_repeat);
+    bsp_co5300_set_window(x + col_start * col_repeat, row_start, x + col_end * col_repeat - 1, row_end - 1);
+    *info->flush_done = false;
+    if (cols == width && repeat == 1)
+    {
+        // Full-width rows are contiguous: one burst
+        bsp_co5300_flush(&s_shown[(row_start - y) * width], (uint32_t)width * (row_end - row_start));
+    }
+    else
+    {
+        // One DMA chain over the panel rows, each pointing at its buffer row; the list is
+        // free again once the block is out
+        int block = 0;
+        for (int row = row_start; row < row_end; row++)
+        {
+            s_chain[block].transfer_count = cols;
+            s_chain[block].read_addr = &s_shown[(row - y) / repeat * width + col_start];
+            block++;
+        }
+        s_chain[block].transfer_count = 0;
+        s_chain[block].read_addr = NULL;
+        bsp_co5300_flush_chain(s_chain);
+    }
+    info->bytes_sent += (uint32_t)cols * col_repeat * (row_end - row_start);
+
+    if (info->row_sent != NULL)
+    {
+        for (int row = row_start; row < row_end; row++)
+        {
+            const uint8_t *pixels = col_repeat == 1 ? &s_shown[(row - y) / repeat * width + col_start] : NULL;
+            info->row_sent(row, pixels, x + col_start * col_repeat, x + col_end * col_repeat);
+        }
+    }
+}
+
+// Sends buffer rows [rect->y, rect->y + rect->height), columns of rect, to the
+// panel at (x, y): under one window, or with mask one per band the rect
+// crosses, cut to the band's columns
+static void send_rect(const dirty_rect_t *rect, int x, int y)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    int col_repeat = info->col_repeat;
+    int row_start = y + rect->y * info->row_repeat;
+    int row_end = y + (rect->y + rect->height) * info->row_repeat;
+    if (!info->mask)
+    {
+        send_block(rect->x, rect->x + rect->width, row_start, row_end, x, y);
+        return;
+    }
+
+    int panel_start = x + rect->x * col_repeat;
+    int panel_end = x + (rect->x + rect->width) * col_repeat;
+    for (int row = row_start; row < row_end;)
+    {
+        const panel_mask_band_t *band = panel_mask_band_of_row(row);
+        int band_end = band->y_end < row_end ? band->y_end : row_end;
+        int x_start = band->x_start > panel_start ? band->x_start : panel_start;
+        int x_end = band->x_end < panel_end ? band->x_end : panel_end;
+        if (x_start < x_end)
+        {
+            // Whole buffer pixels: a repeated pixel the band cuts through is sent in full
+            send_block((x_start - x) / col_repeat, (x_end - x + col_repeat - 1) / col_repeat, row, band_end, x, y);
+        }
+        row = band_end;
+    }
+}
+
+void dirty_rect_present(int x, int y)
+{
+    dirty_rect_info_t *info = g_dirty_rect_info;
+    dirty_rect_t rects[DIRTY_RECT_MAX_RECTS];
+
+    uint32_t t0 = time_us_32();
+    int count = s_shown_valid ? dirty_rect_diff(rects) : -1;
+    info->diff_us += time_us_32() - t0;
+
+    if (count < 0)
+    {
+        dirty_rect_t full = {.x = 0, .y = 0, .width = info->width, .height = info->height};
+        send_rect(&full, x, y);
+        info->full_frames++;
+    }
+    else if (count == 0)
+    {
+        info->clean_frames++;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        send_rect(&rects[i], x, y);
+    }
+    info->rects += count > 0 ? count : 0;
+
+    // The DMA reads the shown buffer until it is done: the next row that changes waits for it
+    s_writable = count == 0 && s_writable;
+    s_shown_valid = true;
+    info->frames++;
+}
@@ -0,0 +1,85 @@
+#ifndef __DIRTY_RECT_H__
+#define __DIRTY_RECT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define DIRTY_RECT_MAX_RECTS 8 // More than this and one full-region present is cheaper
+
+// Region-relative rect
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} dirty_rect_t;
+
+// Called for every panel row span a present sends: columns [x_start, x_end) of
+// panel row y, from `pixels` (panel resolution), or NULL when the PIO repeater
+// widens them on the way out
+typedef void (*dirty_rect_row_sent_t)(int y, const uint8_t *pixels, int x_start, int x_end);
+
+typedef struct
+{
+    uint16_t width;             // Tracked region, composed row by row into the shown buffer; the panel shows width * col_repeat
+    uint16_t height;            // Rows in the buffer; the panel shows height * row_repeat
+    uint8_t row_repeat;         // Integer vertical scale: the DMA sends each row this many times
+    uint8_t col_repeat;         // Integer horizontal scale: the PIO repeater sends each pixel this many times
+    uint16_t window_cost;       // Pixel bytes one extra set_window costs
+    uint8_t max_rects;          // Full present above this, at most DIRTY_RECT_MAX_RECTS
+    bool mask;                  // Clip every rect to the panel_mask bands (present's x, y are panel coordinates)
+    dirty_rect_row_sent_t row_sent; // NULL for none, e.g. black_span_mark to keep its panel state current
+    uint8_t *pool;              // Backing storage for the shown buffer, compose line, spans and DMA chain, word aligned
+    size_t pool_size;           // At least dirty_rect_pool_bytes()
+    volatile bool *flush_done;  // Set by the display DMA completion callback
+
+    // Statistics since the last dirty_rect_reset_stats()
+    uint32_t frames;
+    uint32_t full_frames;  // Sent as one full-region burst (first frame, too many rects, or cheaper)
+    uint32_t clean_frames; // Nothing changed, nothing sent
+    uint32_t rects;
+    uint32_t bytes_sent;
+    uint32_t diff_us;
+} dirty_rect_info_t;
+
+// Pool bytes dirty_rect_init needs for this region: the shown buffer (width *
+// height), a compose line, the row spans and a DMA block per panel row
+size_t dirty_rect_pool_bytes(const dirty_rect_info_t *rect_info);
+
+// Carves the shown buffer (what the panel shows) and a compose line from the
+// pool. The first present is always full. Returns false if they don't fit.
+bool dirty_rect_init(dirty_rect_info_t *rect_info);
+dirty_rect_info_t *dirty_rect_get_info(void);
+
+// Line to compose the next region row into (width bytes)
+uint8_t *dirty_rect_line(void);
+
+// Compares the composed line with row `row` of the shown buffer, records the
+// changed span and copies it in. The first row that changes waits for the
+// previous present's DMA, which reads from the shown buffer.
+void dirty_rect_commit_row(int row);
+
+// Merges the recorded row spans into rects: a row joins the open rect while
+// widening it and bridging the clean rows in between wastes no more than
+// window_cost panel bytes. Rects are in buffer rows.
+// Returns the number of rects, or -1 if a full present is cheaper.
+int dirty_rect_diff(dirty_rect_t *rects);
+
+// Sends the rows committed since the last present to the panel at (x, y),
+// either as the changed rects (one set_window and one chained DMA each, or one
+// per mask band a rect crosses) or as the full region. With row_repeat > 1 the
+// chain lists every buffer row row_repeat times, and with col_repeat > 1 the
+// display's PIO pixel repeater widens every byte, so a scaled frame is composed
+// at source resolution and costs no CPU while it goes out. Returns with the
+// last DMA still running and the pixel repeat left at col_repeat.
+void dirty_rect_present(int x, int y);
+
+// The panel was drawn behind our back: the next present is full
+void dirty_rect_invalidate(void);
+
+void dirty_rect_reset_stats(void);
+
+#endif // __DIRTY_RECT_H__
@@ -0,0 +1,384 @@
+#include "frame_cache.h"
+#include "frame_codec.h"
+#include "hardware/dma.h"
+
+frame_cache_info_t *g_frame_cache_info;
+
+typedef struct
+{
+    int frame_index; // -1 when empty
+    uint32_t offset; // Byte offset into the pool
+    uint32_t size;   // Stored size in bytes
+} frame_cache_entry_t;
+
+// Raw mode uses the first slot_count entries as slots (see s_slot_of_frame);
+// compressed mode indexes entries directly by frame number.
+static frame_cache_entry_t s_entries[FRAME_CACHE_MAX_FRAMES];
+static uint16_t s_slot_count;
+static uint32_t s_pool_used;
+
+// Raw mode: frame -> slot map, slot being filled, and the frames eviction must not touch
+static int16_t s_slot_of_frame[FRAME_CACHE_MAX_FRAMES];
+static int s_store_slot = -1;
+static int s_protect_first = 0;
+static int s_protect_count = 0;
+static int s_protect_total = 1;
+
+// Compressed mode staging frame and decoded line
+static uint8_t *s_staging;
+static uint8_t *s_line;
+static int s_line_frame = -1;
+static int s_line_row = -1;
+
+// External pool: two SRAM row buffers, one being read while the other is filled by DMA
+typedef struct
+{
+    uint8_t *buf;
+    int frame_index;
+    int row;
+    uint32_t skew; // Row start within buf (DMA copies whole words)
+} frame_cache_stage_t;
+
+static frame_cache_stage_t s_stage[2];
+static int s_stage_pending = -1; // Stage with a DMA in flight, -1 if none
+static int s_dma_channel = -1;
+
+static inline uint32_t frame_bytes(void)
+{
+    return (uint32_t)g_frame_cache_info->frame_width * g_frame_cache_info->frame_height;
+}
+
+static frame_cache_entry_t *find_entry(int frame_index)
+{
+    if (frame_index < 0 || frame_index >= FRAME_CACHE_MAX_FRAMES)
+        return NULL;
+
+    frame_cache_entry_t *entry;
+    if (g_frame_cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        int slot = s_slot_of_frame[frame_index];
+        if (slot < 0)
+            return NULL;
+        entry = &s_entries[slot];
+    }
+    else
+    {
+        entry = &s_entries[frame_index];
+    }
+    return entry->frame_index == frame_index ? entry : NULL;
+}
+
+static bool is_protected(int frame_index)
+{
+    int distance = (frame_index - s_protect_first + s_protect_total) % s_protect_total;
+    return distance < s_protect_count;
+}
+
+// Raw mode victim: an empty slot, else any slot outside the protected window
+static int pick_raw_slot(int frame_index)
+{
+    if (s_slot_of_frame[frame_index] >= 0)
+        return s_slot_of_frame[frame_index];
+
+    for (int i = 0; i < s_slot_count; i++)
+    {
+        if (s_entries[i].frame_index < 0)
+            return i;
+    }
+    for (int i = 0; i < s_slot_count; i++)
+    {
+        if (!is_protected(s_entries[i].frame_index))
+            return i;
+    }
+    return -1;
+}
+
+static void stage_wait(void)
+{
+    if (s_stage_pending < 0)
+        return;
+
+    uint32_t t0 = time_us_32();
+    dma_channel_wait_for_finish_blocking(s_dma_channel);
+    g_frame_cache_info->stage_wait_us += time_us_32() - t0;
+    s_stage_pending = -1;
+}
+
+// Starts copying the pool bytes of (frame, row) into stage buffer `index`
+static void stage_start(int index, const frame_cache_entry_t *entry, uint16_t row)
+{
+    const uint8_t *data = &g_frame_cache_info->pool[entry->offset];
+    uint32_t begin, end;
+
+    if (g_frame_cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        begin = row * g_frame_cache_info->frame_width;
+        end = begin + g_frame_cache_info->frame_width;
+    }
+    else
+    {
+        // Two uncached word reads for the row table entry are cheaper than staging it
+        frame_codec_row_span(data, entry->size, g_frame_cache_info->frame_height, row, &begin, &end);
+    }
+
+    // Word-aligned bounds; the pool itself and every blob start are word aligned
+    uint32_t first = begin & ~3u;
+    uint32_t words = ((end + 3) & ~3u) - first;
+    words /= 4;
+
+    frame_cache_stage_t *stage = &s_stage[index];
+    stage->frame_index = entry->frame_index;
+    stage->row = row;
+    stage->skew = begin - first;
+
+    dma_channel_config c = dma_channel_get_default_config(s_dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    dma_channel_configure(s_dma_channel, &c, stage->buf, &data[first], words, true);
+
+    s_stage_pending = index;
+    g_frame_cache_info->rows_staged++;
+}
+
+// Returns the SRAM copy of (frame, row) and prefetches the next row into the other buffer
+static const uint8_t *stage_get(const frame_cache_entry_t *entry, uint16_t row)
+{
+    int hit = -1;
+    for (int i = 0; i < 2; i++)
+    {
+        if (s_stage[i].frame_index == entry->frame_index && s_stage[i].row == row)
+        {
+            hit = i;
+        }
+    }
+
+    if (hit < 0)
+    {
+        stage_wait();
+        hit = 0;
+        stage_start(hit, entry, row);
+    }
+    if (s_stage_pending == hit)
+    {
+        stage_wait();
+    }
+
+    int other = hit ^ 1;
+    if (row + 1 < g_frame_cache_info->frame_height && s_stage_pending < 0 &&
+        !(s_stage[other].frame_index == entry->frame_index && s_stage[other].row == row + 1))
+    {
+        stage_start(other, entry, row + 1);
+    }
+
+    return s_stage[hit].buf + s_stage[hit].skew;
+}
+
+static void stage_invalidate(void)
+{
+    stage_wait();
+    for (int i = 0; i < 2; i++)
+    {
+        s_stage[i].frame_index = -1;
+        s_stage[i].row = -1;
+    }
+}
+
+void frame_cache_reset(void)
+{
+    for (int i = 0; i < FRAME_CACHE_MAX_FRAMES; i++)
+    {
+        s_entries[i].frame_index = -1;
+        s_entries[i].offset = 0;
+        s_entries[i].size = 0;
+        s_slot_of_frame[i] = -1;
+    }
+    s_pool_used = 0;
+    s_store_slot = -1;
+    s_protect_count = 0;
+    s_line_frame = -1;
+    s_line_row = -1;
+    if (s_dma_channel >= 0)
+    {
+        stage_invalidate();
+    }
+
+    g_frame_cache_info->frames_stored = 0;
+    g_frame_cache_info->raw_bytes = 0;
+    g_frame_cache_info->stored_bytes = 0;
+    g_frame_cache_info->rows_decoded = 0;
+    g_frame_cache_info->decode_us = 0;
+    g_frame_cache_info->rows_staged = 0;
+    g_frame_cache_info->stage_wait_us = 0;
+}
+
+void frame_cache_init(frame_cache_info_t *cache_info)
+{
+    g_frame_cache_info = cache_info;
+
+    if (cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        s_slot_count = cache_info->pool_size / frame_bytes();
+        if (s_slot_count > FRAME_CACHE_MAX_FRAMES)
+        {
+            s_slot_count = FRAME_CACHE_MAX_FRAMES;
+        }
+    }
+    else
+    {
+        s_slot_count = 0;
+        if (s_staging == NULL)
+        {
+            s_staging = malloc(frame_bytes());
+        }
+    }
+
+    if (s_line == NULL)
+    {
+        s_line = malloc(cache_info->frame_width);
+    }
+
+    if (cache_info->external_pool && s_dma_channel < 0)
+    {
+        // Large enough for a raw row or a worst-case compressed row, plus word rounding
+        size_t stage_size = FRAME_CODEC_MAX_SIZE(cache_info->frame_width, 1) + 8;
+        s_dma_channel = dma_claim_unused_channel(true);
+        for (int i = 0; i < 2; i++)
+        {
+            s_stage[i].buf = malloc(stage_size);
+        }
+    }
+
+    frame_cache_reset();
+}
+
+frame_cache_info_t *frame_cache_get_info(void)
+{
+    return g_frame_cache_info;
+}
+
+bool frame_cache_contains(int frame_index)
+{
+    return find_entry(frame_index) != NULL;
+}
+
+uint16_t frame_cache_slot_count(void)
+{
+    return s_slot_count;
+}
+
+void frame_cache_set_protected(int first_frame, int count, int total_frames)
+{
+    s_protect_first = first_frame;
+    s_protect_count = count;
+    s_protect_total = total_frames > 0 ? total_frames : 1;
+}
+
+uint8_t *frame_cache_begin_store(int frame_index)
+{
+    if (frame_index < 0 || frame_index >= FRAME_CACHE_MAX_FRAMES)
+        return NULL;
+
+    if (g_frame_cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        int slot = pick_raw_slot(frame_index);
+        if (slot < 0)
+            return NULL;
+
+        // Evict the previous occupant; the slot is invalid until committed
+        if (s_entries[slot].frame_index >= 0)
+        {
+            s_slot_of_frame[s_entries[slot].frame_index] = -1;
+        }
+        s_entries[slot].frame_index = -1;
+        s_store_slot = slot;
+        if (g_frame_cache_info->external_pool)
+        {
+            stage_invalidate();
+        }
+        return &g_frame_cache_info->pool[slot * frame_bytes()];
+    }
+
+    if (s_staging == NULL)
+        return NULL;
+    return s_staging;
+}
+
+bool frame_cache_commit_store(int frame_index)
+{
+    if (g_frame_cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        int slot = s_store_slot;
+        if (slot < 0)
+            return false;
+        s_entries[slot].frame_index = frame_index;
+        s_entries[slot].offset = slot * frame_bytes();
+        s_entries[slot].size = frame_bytes();
+        s_slot_of_frame[frame_index] = slot;
+        s_store_slot = -1;
+        return true;
+    }
+
+    // Compressed blobs start with a uint32_t row table, keep them word aligned
+    uint32_t offset = (s_pool_used + 3) & ~3u;
+    if (offset >= g_frame_cache_info->pool_size)
+        return false;
+
+    size_t size = frame_codec_encode(s_staging,
+                                     g_frame_cache_info->frame_width,
+                                     g_frame_cache_info->frame_height,
+                                     &g_frame_cache_info->pool[offset],
+                                     g_frame_cache_info->pool_size - offset);
+    if (size == 0)
+        return false;
+
+    s_entries[frame_index].frame_index = frame_index;
+    s_entries[frame_index].offset = offset;
+    s_entries[frame_index].size = size;
+    s_pool_used = offset + size;
+
+    g_frame_cache_info->frames_stored++;
+    g_frame_cache_info->raw_bytes += frame_bytes();
+    g_frame_cache_info->stored_bytes += size;
+    return true;
+}
+
+const uint8_t *frame_cache_get_row(int frame_index, uint16_t row)
+{
+    frame_cache_entry_t *entry = find_entry(frame_index);
+    if (entry == NULL)
+        return NULL;
+
+    const uint8_t *data = &g_frame_cache_info->pool[entry->offset];
+    if (g_frame_cache_info->mode == FRAME_CACHE_MODE_RAW)
+    {
+        if (g_frame_cache_info->external_pool)
+        {
+            return stage_get(entry, row);
+        }
+        return &data[row * g_frame_cache_info->frame_width];
+    }
+
+    if (frame_index != s_line_frame || row != s_line_row)
+    {
+        const uint8_t *tokens;
+        if (g_frame_cache_info->external_pool)
+        {
+            tokens = stage_get(entry, row);
+        }
+        else
+        {
+            uint32_t begin, end;
+            frame_codec_row_span(data, entry->size, g_frame_cache_info->frame_height, row, &begin, &end);
+            tokens = &data[begin];
+        }
+
+        uint32_t t0 = time_us_32();
+        frame_codec_decode_tokens(tokens, g_frame_cache_info->frame_width, s_line);
+        g_frame_cache_info->decode_us += time_us_32() - t0;
+        g_frame_cache_info->rows_decoded++;
+        s_line_frame = frame_index;
+        s_line_row = row;
+    }
+    return s_line;
+}
@@ -0,0 +1,63 @@
+#ifndef __FRAME_CACHE_H__
+#define __FRAME_CACHE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define FRAME_CACHE_MAX_FRAMES 1024 // Upper bound on raw slots / frame numbers (playlist length)
+
+typedef enum
+{
+    FRAME_CACHE_MODE_RAW = 0,   // Fixed-size slots, one raw frame each, any frame in any slot
+    FRAME_CACHE_MODE_COMPRESSED // Variable-size frame_codec blobs packed into the pool
+} frame_cache_mode_t;
+
+typedef struct
+{
+    frame_cache_mode_t mode;
+    uint16_t frame_width;
+    uint16_t frame_height;
+
+    uint8_t *pool;      // Backing storage for slots / compressed blobs
+    size_t pool_size;   // Size of pool in bytes
+    bool external_pool; // Pool is XIP-mapped (PSRAM): rows are DMA-staged into SRAM before use
+
+    // Statistics (compressed mode)
+    uint32_t frames_stored;
+    uint32_t raw_bytes;      // Sum of uncompressed sizes of stored frames
+    uint32_t stored_bytes;   // Sum of compressed sizes of stored frames
+    uint32_t rows_decoded;   // Rows expanded by frame_cache_get_row
+    uint64_t decode_us;      // Time spent decoding those rows (64-bit: it is never reset)
+    uint32_t rows_staged;    // External pool: rows copied into SRAM by DMA
+    uint32_t stage_wait_us;  // External pool: time spent waiting on staging DMA
+} frame_cache_info_t;
+
+void frame_cache_init(frame_cache_info_t *cache_info);
+frame_cache_info_t *frame_cache_get_info(void);
+
+// Forget every stored frame (pool contents are left as-is)
+void frame_cache_reset(void);
+
+bool frame_cache_contains(int frame_index);
+uint16_t frame_cache_slot_count(void);
+
+// Raw mode: frames [first_frame, first_frame + count) (mod total_frames) are never
+// chosen for eviction. Storing a frame when every slot is protected fails.
+void frame_cache_set_protected(int first_frame, int count, int total_frames);
+
+// Two-step store: read the raw frame into the returned buffer, then commit it.
+// In compressed mode the commit encodes from a staging buffer into the pool and
+// fails (returns false) once the pool is full.
+uint8_t *frame_cache_begin_store(int frame_index);
+bool frame_cache_commit_store(int frame_index);
+
+// Returns one raw row of a cached frame, or NULL if the frame is not cached.
+// Compressed rows are decoded into an internal line buffer that stays valid
+// until the next call; repeated requests for the same row are not re-decoded.
+// With an external pool the row is staged into SRAM by DMA and the following
+// row is prefetched while the caller composes this one.
+const uint8_t *frame_cache_get_row(int frame_index, uint16_t row);
+
+#endif // __FRAME_CACHE_H__
@@ -0,0 +1,136 @@
+#include "frame_codec.h"
+#include <string.h>
+
+// Length of the run of identical pixels starting at row[x]
+static uint16_t run_length(const uint8_t *row, uint16_t x, uint16_t width)
+{
+    uint16_t end = x + 1;
+    while (end < width && row[end] == row[x])
+    {
+        end++;
+    }
+    return end - x;
+}
+
+// Encodes one row. Returns bytes written, or 0 if dst_len is too small.
+static size_t encode_row(const uint8_t *row, uint16_t width, uint8_t *dst, size_t dst_len)
+{
+    size_t out = 0;
+    uint16_t x = 0;
+
+    while (x < width)
+    {
+        uint16_t run = run_length(row, x, width);
+
+        if (row[x] == 0x00 && run >= 2)
+        {
+            // Black run: long form first, short form for the tail
+            while (run >= FRAME_CODEC_ZERO_LONG_MIN)
+            {
+                uint16_t n = run > FRAME_CODEC_ZERO_LONG_MAX ? FRAME_CODEC_ZERO_LONG_MAX : run;
+                uint16_t biased = n - FRAME_CODEC_ZERO_LONG_MIN;
+                if (out + 2 > dst_len)
+                    return 0;
+                dst[out++] = FRAME_CODEC_OP_ZERO_LONG | (biased >> 8);
+                dst[out++] = biased & 0xFF;
+                x += n;
+                run -= n;
+            }
+            if (run > 0)
+            {
+                if (out + 1 > dst_len)
+                    return 0;
+                dst[out++] = FRAME_CODEC_OP_ZERO | (run - 1);
+                x += run;
+            }
+        }
+        else if (run >= FRAME_CODEC_FILL_MIN)
+        {
+            uint16_t n = run > FRAME_CODEC_FILL_MAX ? FRAME_CODEC_FILL_MAX : run;
+            if (out + 2 > dst_len)
+                return 0;
+            dst[out++] = FRAME_CODEC_OP_FILL | (n - FRAME_CODEC_FILL_MIN);
+            dst[out++] = row[x];
+            x += n;
+        }
+        else
+        {
+            // Gather literals until a run worth its own token starts
+            uint16_t start = x;
+            while (x < width && (x - start) < FRAME_CODEC_SHORT_MAX)
+            {
+                uint16_t r = run_length(row, x, width);
+                if (r >= FRAME_CODEC_FILL_MIN || (row[x] == 0x00 && r >= 2))
+                    break;
+                x++;
+            }
+            uint16_t n = x - start;
+            if (out + 1 + n > dst_len)
+                return 0;
+            dst[out++] = FRAME_CODEC_OP_LITERAL | (n - 1);
+            memcpy(&dst[out], &row[start], n);
+            out += n;
+        }
+    }
+    return out;
+}
+
+size_t frame_codec_encode(const uint8_t *src, uint16_t width, uint16_t height, uint8_t *dst, size_t dst_len)
+{
+    size_t table_len = (size_t)height * sizeof(uint32_t);
+    if (dst_len < table_len)
+        return 0;
+
+    uint32_t *row_offset = (uint32_t *)dst;
+    size_t out = table_len;
+
+    for (uint16_t y = 0; y < height; y++)
+    {
+        row_offset[y] = out;
+        size_t n = encode_row(&src[(size_t)y * width], width, &dst[out], dst_len - out);
+        if (n == 0)
+            return 0;
+        out += n;
+    }
+    return out;
+}
+
+void frame_codec_decode_row(const uint8_t *encoded, uint16_t width, uint16_t row, uint8_t *dst)
+{
+    const uint32_t *row_offset = (const uint32_t *)encoded;
+    frame_codec_decode_tokens(&encoded[row_offset[row]], width, dst);
+}
+
+void frame_codec_decode_tokens(const uint8_t *tokens, uint16_t width, uint8_t *dst)
+{
+    const uint8_t *src = tokens;
+    uint8_t *end = dst + width;
+
+    while (dst < end)
+    {
+        uint8_t token = *src++;
+        uint16_t n = (token & 0x3F);
+
+        switch (token & 0xC0)
+        {
+        case FRAME_CODEC_OP_ZERO:
+            n += 1;
+            memset(dst, 0x00, n);
+            break;
+        case FRAME_CODEC_OP_LITERAL:
+            n += 1;
+            memcpy(dst, src, n);
+            src += n;
+            break;
+        case FRAME_CODEC_OP_FILL:
+            n += FRAME_CODEC_FILL_MIN;
+            memset(dst, *src++, n);
+            break;
+        default: // FRAME_CODEC_OP_ZERO_LONG
+            n = ((n << 8) | *src++) + FRAME_CODEC_ZERO_LONG_MIN;
+            memset(dst, 0x00, n);
+            break;
+        }
+        dst += n;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef __FRAME_CODEC_H__
+#define __FRAME_CODEC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Row-addressable RLE codec for RGB332 frames.
+//
+// Encoded frame layout:
+//   uint32_t row_offset[height];   // byte offset of each row's token stream from the blob start
+//   uint8_t  tokens[];             // per-row token streams, each decoding to exactly `width` pixels
+//
+// Token bytes (top two bits select the op, low six bits are a count):
+//   00nnnnnn              n + 1 black pixels (1..64)
+//   01nnnnnn <n+1 bytes>  n + 1 literal pixels (1..64)
+//   10nnnnnn <v>          n + 3 copies of pixel v (3..66)
+//   11nnnnnn <lo>         ((n << 8) | lo) + 65 black pixels (65..16448)
+//
+// Black gets two dedicated ops because AMOLED content is composited onto black
+// by convert.py, so long zero runs dominate most rows.
+
+#define FRAME_CODEC_OP_ZERO 0x00
+#define FRAME_CODEC_OP_LITERAL 0x40
+#define FRAME_CODEC_OP_FILL 0x80
+#define FRAME_CODEC_OP_ZERO_LONG 0xC0
+
+#define FRAME_CODEC_SHORT_MAX 64
+#define FRAME_CODEC_FILL_MIN 3
+#define FRAME_CODEC_FILL_MAX (FRAME_CODEC_SHORT_MAX + FRAME_CODEC_FILL_MIN - 1)
+#define FRAME_CODEC_ZERO_LONG_MIN (FRAME_CODEC_SHORT_MAX + 1)
+#define FRAME_CODEC_ZERO_LONG_MAX (FRAME_CODEC_ZERO_LONG_MIN + 0x3FFF)
+
+// Worst case: row table plus every row stored as literal chunks
+#define FRAME_CODEC_MAX_SIZE(w, h) ((size_t)(h) * 4 + (size_t)(h) * ((w) + ((w) + FRAME_CODEC_SHORT_MAX - 1) / FRAME_CODEC_SHORT_MAX))
+
+// Encodes a width x height frame into dst. Returns the encoded size, or 0 if it does not fit in dst_len.
+size_t frame_codec_encode(const uint8_t *src, uint16_t width, uint16_t height, uint8_t *dst, size_t dst_len);
+
+// Decodes a single row of an encoded frame into dst (width bytes).
+void frame_codec_decode_row(const uint8_t *encoded, uint16_t width, uint16_t row, uint8_t *dst);
+
+// Decodes one row's token stream (as located by the row table) into dst.
+void frame_codec_decode_tokens(const uint8_t *tokens, uint16_t width, uint8_t *dst);
+
+// Byte range [begin, end) of a row's tokens within an encoded frame of encoded_size bytes.
+static inline void frame_codec_row_span(const uint8_t *encoded, size_t encoded_size, uint16_t height, uint16_t row,
+                                        uint32_t *begin, uint32_t *end)
+{
+    const uint32_t *row_offset = (const uint32_t *)encoded;
+    *begin = row_offset[row];
+    *end = (row + 1 < height) ? row_offset[row + 1] : encoded_size;
+}
+
+#endif // __FRAME_CODEC_H__
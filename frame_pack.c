@@ -0,0 +1,245 @@
+#include "frame_pack.h"
+#include "diskio.h"
+#include "disk_cache.h"
+
+frame_pack_info_t *g_frame_pack_info;
+
+static frame_pack_header_t s_header;
+static uint8_t s_tail[FRAME_PACK_SECTOR]; // Last, partial sector of a frame
+static uint8_t s_chunk[FRAME_PACK_CHUNK_SECTORS * FRAME_PACK_SECTOR]; // Copy buffer for packing
+
+_Static_assert(sizeof(frame_pack_header_t) <= FRAME_PACK_SECTOR, "pack header must fit its sector");
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len--)
+    {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t frame_pack_playlist_hash(void)
+{
+    playlist_info_t *playlist = playlist_get_info();
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < playlist->clip_count; i++)
+    {
+        const playlist_clip_t *clip = playlist_get_clip(i);
+        hash = fnv1a(hash, clip->name, strlen(clip->name) + 1);
+        hash = fnv1a(hash, &clip->frame_count, sizeof(clip->frame_count));
+    }
+    for (int i = 0; i < playlist->frame_count; i++)
+    {
+        // Durations don't change what is stored
+        const playlist_frame_t *frame = playlist_get_frame(i);
+        hash = fnv1a(hash, &frame->clip, sizeof(frame->clip));
+        hash = fnv1a(hash, &frame->file_index, sizeof(frame->file_index));
+    }
+    return fnv1a(hash, &g_frame_pack_info->frame_bytes, sizeof(g_frame_pack_info->frame_bytes));
+}
+
+static LBA_t first_sector_of(FIL *fil)
+{
+    FATFS *fs = fil->obj.fs;
+    return fs->database + (LBA_t)(fil->obj.sclust - 2) * fs->csize;
+}
+
+// Copies every playlist frame into the container through s_chunk. Every write is
+// whole sectors, and the frame's last chunk is zero-padded to the slot's end.
+static bool pack(uint32_t hash)
+{
+    frame_pack_info_t *info = g_frame_pack_info;
+    int frame_count = playlist_get_info()->frame_count;
+    uint32_t slot_bytes = info->slot_sectors * FRAME_PACK_SECTOR;
+    FSIZE_t container_size = (FSIZE_t)FRAME_PACK_SECTOR + (FSIZE_t)frame_count * slot_bytes;
+    FIL fil;
+    UINT bytes;
+
+    if (f_open(&fil, info->path, FA_CREATE_ALWAYS | FA_WRITE | FA_READ) != FR_OK)
+    {
+        printf("Pack: can't create %s\n", info->path);
+        return false;
+    }
+    FRESULT fr = f_expand(&fil, container_size, 1);
+    if (fr != FR_OK)
+    {
+        printf("Pack: no contiguous %u KB for %s (error %d)\n", (unsigned)(container_size / 1024), info->path, fr);
+        f_close(&fil);
+        f_unlink(info->path);
+        return false;
+    }
+
+    // The header is written last, so an interrupted pass leaves an invalid container
+    memset(&s_header, 0, sizeof(s_header));
+    memset(s_chunk, 0, FRAME_PACK_SECTOR);
+    bool ok = f_write(&fil, s_chunk, FRAME_PACK_SECTOR, &bytes) == FR_OK && bytes == FRAME_PACK_SECTOR;
+
+    for (int i = 0; ok && i < frame_count; i++)
+    {
+        char path[PLAYLIST_MAX_PATH];
+        FIL src;
+        const playlist_frame_t *frame = playlist_get_frame(i);
+        bool have_src = (frame->file_size == 0 || frame->file_size == info->frame_bytes) &&
+                        playlist_frame_path(i, path, sizeof(path)) &&
+                        f_open(&src, path, FA_READ) == FR_OK;
+        bool complete = have_src;
+
+        for (uint32_t offset = 0; ok && offset < slot_bytes; offset += sizeof(s_chunk))
+        {
+            UINT chunk = slot_bytes - offset < sizeof(s_chunk) ? slot_bytes - offset : sizeof(s_chunk);
+            UINT want = offset >= info->frame_bytes ? 0 : info->frame_bytes - offset < chunk ? info->frame_bytes - offset : chunk;
+            UINT got = 0;
+            if (complete && want > 0 && (f_read(&src, s_chunk, want, &got) != FR_OK || got != want))
+            {
+                complete = false; // Short or failed source: the rest of the slot is zeros
+            }
+            memset(s_chunk + got, 0, chunk - got);
+            ok = f_write(&fil, s_chunk, chunk, &bytes) == FR_OK && bytes == chunk;
+        }
+        if (have_src)
+        {
+            f_close(&src);
+        }
+        if (complete)
+        {
+            s_header.packed[i / 8] |= 1 << (i % 8);
+            info->frames_packed++;
+        }
+    }
+
+    if (ok)
+    {
+        s_header.magic = FRAME_PACK_MAGIC;
+        s_header.version = FRAME_PACK_VERSION;
+        s_header.frame_count = frame_count;
+        s_header.playlist_hash = hash;
+        s_header.frame_bytes = info->frame_bytes;
+        s_header.slot_sectors = info->slot_sectors;
+        s_header.start_lba = first_sector_of(&fil);
+        ok = f_lseek(&fil, 0) == FR_OK &&
+             f_write(&fil, &s_header, sizeof(s_header), &bytes) == FR_OK && bytes == sizeof(s_header);
+    }
+    if (f_close(&fil) != FR_OK)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        printf("Pack: write to %s failed, removing it\n", info->path);
+        f_unlink(info->path);
+    }
+    return ok;
+}
+
+// Opens the container and checks its header against the playlist and its own location
+static bool check(uint32_t hash)
+{
+    frame_pack_info_t *info = g_frame_pack_info;
+    FIL fil;
+    UINT bytes;
+
+    if (f_open(&fil, info->path, FA_READ) != FR_OK)
+        return false;
+
+    bool ok = f_read(&fil, &s_header, sizeof(s_header), &bytes) == FR_OK && bytes == sizeof(s_header) &&
+              s_header.magic == FRAME_PACK_MAGIC && s_header.version == FRAME_PACK_VERSION &&
+              s_header.playlist_hash == hash && s_header.frame_bytes == info->frame_bytes &&
+              s_header.slot_sectors == info->slot_sectors &&
+              s_header.frame_count == playlist_get_info()->frame_count &&
+              f_size(&fil) >= (FSIZE_t)FRAME_PACK_SECTOR * (1 + (FSIZE_t)s_header.frame_count * s_header.slot_sectors) &&
+              s_header.start_lba == first_sector_of(&fil); // Moved or rewritten off-device: repack
+
+    if (ok)
+    {
+        info->pdrv = fil.obj.fs->pdrv;
+        info->start_lba = s_header.start_lba;
+        info->frames_packed = 0;
+        for (int i = 0; i < s_header.frame_count; i++)
+        {
+            if (s_header.packed[i / 8] & (1 << (i % 8)))
+            {
+                info->frames_packed++;
+            }
+        }
+    }
+    f_close(&fil);
+    return ok;
+}
+
+bool frame_pack_init(frame_pack_info_t *pack_info)
+{
+    g_frame_pack_info = pack_info;
+    pack_info->valid = false;
+    pack_info->repacked = false;
+    pack_info->frames_packed = 0;
+    pack_info->pack_ms = 0;
+    pack_info->slot_sectors = (pack_info->frame_bytes + FRAME_PACK_SECTOR - 1) / FRAME_PACK_SECTOR;
+
+    uint32_t hash = frame_pack_playlist_hash();
+    if (!check(hash))
+    {
+        printf("Pack: %s missing or stale, packing %u frames...\n", pack_info->path, playlist_get_info()->frame_count);
+        uint32_t start_us = time_us_32();
+        pack_info->frames_packed = 0;
+        pack_info->repacked = pack(hash);
+        pack_info->pack_ms = (time_us_32() - start_us) / 1000;
+        if (!pack_info->repacked || !check(hash))
+            return false;
+    }
+
+    pack_info->valid = true;
+    printf("Pack: %u of %u frames contiguous at LBA %u", pack_info->frames_packed,
+           playlist_get_info()->frame_count, (unsigned)pack_info->start_lba);
+    if (pack_info->repacked)
+    {
+        printf(" (packed this boot in %u ms)", pack_info->pack_ms);
+    }
+    printf("\n");
+    return true;
+}
+
+frame_pack_info_t *frame_pack_get_info(void)
+{
+    return g_frame_pack_info;
+}
+
+bool frame_pack_contains(int frame_index)
+{
+    return g_frame_pack_info != NULL && g_frame_pack_info->valid &&
+           frame_index >= 0 && frame_index < s_header.frame_count &&
+           (s_header.packed[frame_index / 8] & (1 << (frame_index % 8)));
+}
+
+bool frame_pack_read(int frame_index, uint8_t *dst)
+{
+    if (!frame_pack_contains(frame_index))
+        return false;
+
+    frame_pack_info_t *info = g_frame_pack_info;
+    LBA_t lba = info->start_lba + 1 + (LBA_t)frame_index * info->slot_sectors;
+    UINT whole = info->frame_bytes / FRAME_PACK_SECTOR;
+    UINT tail = info->frame_bytes % FRAME_PACK_SECTOR;
+
+    if (whole > 0 && disk_read_uncached(info->pdrv, dst, lba, whole) != RES_OK)
+        return false;
+    if (tail > 0)
+    {
+        if (disk_read_uncached(info->pdrv, s_tail, lba + whole, 1) != RES_OK)
+            return false;
+        memcpy(&dst[whole * FRAME_PACK_SECTOR], s_tail, tail);
+    }
+    return true;
+}
+
+bool frame_pack_read_sectors(int frame_index, uint32_t first_sector, uint32_t count, uint8_t *dst)
+{
+    frame_pack_info_t *info = g_frame_pack_info;
+    if (!frame_pack_contains(frame_index) || first_sector + count > info->slot_sectors)
+        return false;
+
+    LBA_t lba = info->start_lba + 1 + (LBA_t)frame_index * info->slot_sectors + first_sector;
+    return count == 0 || disk_read_uncached(info->pdrv, dst, lba, count) == RES_OK;
+}
@@ -0,0 +1,65 @@
+#ifndef __FRAME_PACK_H__
+#define __FRAME_PACK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "ff.h"
+#include "playlist.h"
+
+// Container layout: one header sector, then every playlist frame in a fixed
+// run of whole sectors. The file is preallocated contiguous with f_expand, so
+// frame N lives at start_lba + 1 + N * slot_sectors and is read without FatFS.
+#define FRAME_PACK_MAGIC 0x4B415046u // "FPAK"
+#define FRAME_PACK_VERSION 1
+#define FRAME_PACK_SECTOR 512
+#define FRAME_PACK_CHUNK_SECTORS 8 // Packing copies through a static buffer of this many sectors
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frame_count;
+    uint32_t playlist_hash; // Playlist the container was built from
+    uint32_t frame_bytes;
+    uint32_t slot_sectors;
+    uint64_t start_lba;     // Where the container was when it was written
+    uint8_t packed[PLAYLIST_MAX_FRAMES / 8]; // Frames that were copied in
+} frame_pack_header_t;
+
+typedef struct
+{
+    const char *path;     // Container file, e.g. "/output/pack.bin"
+    uint32_t frame_bytes; // Size of every frame file
+
+    // State
+    bool valid;            // Container matches the playlist, frames stream from raw LBAs
+    bool repacked;         // Container was (re)built this boot
+    uint8_t pdrv;          // Physical drive holding the container
+    LBA_t start_lba;       // First sector of the container (its header)
+    uint32_t slot_sectors; // Sectors per frame
+    uint16_t frames_packed;
+    uint32_t pack_ms;      // Time the pack pass took, 0 if not run
+} frame_pack_info_t;
+
+// Opens the container and checks it against the current playlist. If the
+// playlist hash changed (or there is no container) the frames are copied into
+// a freshly f_expand-ed contiguous file first. Returns info->valid.
+bool frame_pack_init(frame_pack_info_t *pack_info);
+frame_pack_info_t *frame_pack_get_info(void);
+
+// Hash of the playlist tables; a different hash means the container is stale
+uint32_t frame_pack_playlist_hash(void);
+
+bool frame_pack_contains(int frame_index);
+
+// Reads one frame straight from the card with disk_read (multi-block for the
+// whole sectors, one more block for the tail). dst needs frame_bytes.
+bool frame_pack_read(int frame_index, uint8_t *dst);
+
+// Reads count whole sectors of a frame's slot, starting first_sector into it.
+// The slot's padding past frame_bytes reads as zeros. dst needs count * 512.
+bool frame_pack_read_sectors(int frame_index, uint32_t first_sector, uint32_t count, uint8_t *dst);
+
+#endif // __FRAME_PACK_H__
@@ -0,0 +1,175 @@
+#include "frame_scheduler.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+frame_scheduler_info_t *g_frame_scheduler_info;
+
+static volatile bool s_alarm_fired;
+static uint64_t s_next_us;        // Presentation time of the next frame
+static uint8_t s_consecutive_drops;
+static uint32_t s_stage_us[FRAME_STAGE_COUNT]; // Since the last frame_scheduler_wait
+
+static void frame_scheduler_alarm_callback(uint alarm_num)
+{
+    s_alarm_fired = true;
+    __sev(); // Wake the WFE in frame_scheduler_wait
+}
+
+void frame_scheduler_init(frame_scheduler_info_t *scheduler_info)
+{
+    g_frame_scheduler_info = scheduler_info;
+
+    scheduler_info->alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(scheduler_info->alarm_num, frame_scheduler_alarm_callback);
+
+    frame_scheduler_reset_stats();
+    frame_scheduler_restart();
+}
+
+frame_scheduler_info_t *frame_scheduler_get_info(void)
+{
+    return g_frame_scheduler_info;
+}
+
+void frame_scheduler_restart(void)
+{
+    s_next_us = time_us_64();
+    s_consecutive_drops = 0;
+}
+
+void frame_scheduler_reset_stats(void)
+{
+    frame_scheduler_info_t *info = g_frame_scheduler_info;
+    info->frames_presented = 0;
+    info->frames_late = 0;
+    info->frames_on_time = 0;
+    info->frames_dropped = 0;
+    info->jitter_sum_us = 0;
+    info->jitter_max_us = 0;
+    info->late_max_us = 0;
+    for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+    {
+        info->late_by_stage[i] = 0;
+        info->dropped_by_stage[i] = 0;
+    }
+}
+
+void frame_scheduler_stage_time(frame_stage_t stage, uint32_t us)
+{
+    s_stage_us[stage] += us;
+}
+
+// Stage that consumed the most time since the last wait
+static frame_stage_t slowest_stage(void)
+{
+    frame_stage_t slowest = FRAME_STAGE_SD;
+    for (int i = 1; i < FRAME_STAGE_COUNT; i++)
+    {
+        if (s_stage_us[i] > s_stage_us[slowest])
+        {
+            slowest = i;
+        }
+    }
+    return slowest;
+}
+
+bool frame_scheduler_deadline_passed(uint32_t duration_us)
+{
+    return g_frame_scheduler_info->policy == FRAME_SCHEDULER_POLICY_DROP &&
+           duration_us != 0 &&
+           s_consecutive_drops < FRAME_SCHEDULER_MAX_CONSECUTIVE_DROPS &&
+           time_us_64() >= s_next_us + duration_us;
+}
+
+int frame_scheduler_stale_frames(const uint16_t *durations_ms, int next_frame, int total_frames)
+{
+    if (g_frame_scheduler_info->policy != FRAME_SCHEDULER_POLICY_DROP)
+        return 0;
+
+    uint64_t now_us = time_us_64();
+    uint64_t slot_end_us = s_next_us;
+    int stale = 0;
+    while (stale < FRAME_SCHEDULER_MAX_CONSECUTIVE_DROPS - s_consecutive_drops && stale < total_frames - 1)
+    {
+        uint32_t duration_us = durations_ms[(next_frame + stale) % total_frames] * 1000;
+        slot_end_us += duration_us;
+        if (duration_us == 0 || slot_end_us > now_us)
+            break;
+        stale++;
+    }
+    return stale;
+}
+
+bool frame_scheduler_wait(uint32_t duration_us)
+{
+    frame_scheduler_info_t *info = g_frame_scheduler_info;
+    uint64_t target_us = s_next_us;
+    uint64_t now_us = time_us_64();
+    frame_stage_t blamed = slowest_stage();
+
+    for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+    {
+        s_stage_us[i] = 0;
+    }
+
+    if (duration_us == 0)
+    {
+        // Unpaced frame: keep the timeline anchored to now
+        s_next_us = now_us;
+        info->frames_presented++;
+        return true;
+    }
+
+    if (frame_scheduler_deadline_passed(duration_us))
+    {
+        s_consecutive_drops++;
+        info->frames_dropped++;
+        info->dropped_by_stage[blamed]++;
+        s_next_us = target_us + duration_us;
+        return false;
+    }
+    s_consecutive_drops = 0;
+
+    if (now_us > target_us + info->late_threshold_us)
+    {
+        uint32_t late_us = now_us - target_us;
+        info->frames_late++;
+        info->late_by_stage[blamed]++;
+        if (late_us > info->late_max_us)
+        {
+            info->late_max_us = late_us;
+        }
+
+        // SLIP restarts the timeline from now; DROP presents the late frame but keeps
+        // the original timeline so following frames catch up
+        s_next_us = (info->policy == FRAME_SCHEDULER_POLICY_SLIP ? now_us : target_us) + duration_us;
+        info->frames_presented++;
+        return true;
+    }
+
+    if (now_us < target_us)
+    {
+        s_alarm_fired = false;
+        // set_target returns true if the target has already passed
+        if (!hardware_alarm_set_target(info->alarm_num, from_us_since_boot(target_us)))
+        {
+            while (!s_alarm_fired)
+            {
+                __wfe();
+            }
+        }
+        now_us = time_us_64();
+    }
+
+    uint32_t jitter_us = now_us > target_us ? now_us - target_us : target_us - now_us;
+    info->frames_on_time++;
+    info->jitter_sum_us += jitter_us;
+    if (jitter_us > info->jitter_max_us)
+    {
+        info->jitter_max_us = jitter_us;
+    }
+
+    s_next_us = target_us + duration_us;
+    info->frames_presented++;
+    return true;
+}
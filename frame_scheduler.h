@@ -0,0 +1,69 @@
+#ifndef __FRAME_SCHEDULER_H__
+#define __FRAME_SCHEDULER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define FRAME_SCHEDULER_MAX_CONSECUTIVE_DROPS 4 // Present anyway after this many drops so the screen never freezes
+
+typedef enum
+{
+    FRAME_SCHEDULER_POLICY_SLIP = 0, // Present late frames and shift the timeline back by the lateness
+    FRAME_SCHEDULER_POLICY_DROP      // Skip frames whose display slot has passed, stay on the original timeline
+} frame_scheduler_policy_t;
+
+// Pipeline stages a late or dropped frame is blamed on
+typedef enum
+{
+    FRAME_STAGE_SD = 0,  // Frame loads (prefetch and underrun)
+    FRAME_STAGE_COMPOSE, // Compose + send to the panel
+    FRAME_STAGE_COUNT
+} frame_stage_t;
+
+typedef struct
+{
+    frame_scheduler_policy_t policy;
+    uint32_t late_threshold_us; // Lateness tolerated before a frame counts as late
+
+    uint alarm_num; // Claimed hardware_timer alarm
+
+    // Statistics since the last frame_scheduler_reset_stats()
+    uint32_t frames_presented;
+    uint32_t frames_late;
+    uint32_t frames_on_time; // Paced frames woken at their target: the frames jitter_sum_us covers
+    uint32_t frames_dropped;
+    uint32_t jitter_sum_us;  // Wake-up error of on-time frames
+    uint32_t jitter_max_us;
+    uint32_t late_max_us;    // Worst lateness seen
+    uint32_t late_by_stage[FRAME_STAGE_COUNT];    // Stage that used the most time before each late frame
+    uint32_t dropped_by_stage[FRAME_STAGE_COUNT]; // Same, for dropped frames
+} frame_scheduler_info_t;
+
+void frame_scheduler_init(frame_scheduler_info_t *scheduler_info);
+frame_scheduler_info_t *frame_scheduler_get_info(void);
+
+// Restarts the timeline: the next frame is due now
+void frame_scheduler_restart(void);
+
+// Waits (WFE on a hardware alarm) until the next frame is due. duration_us is
+// how long that frame stays on screen; 0 presents immediately with no pacing.
+// Returns false when the DROP policy decides this frame should be skipped.
+bool frame_scheduler_wait(uint32_t duration_us);
+
+// DROP policy: true if the next frame's whole display slot is already over,
+// i.e. frame_scheduler_wait will skip it. Always false under SLIP.
+bool frame_scheduler_deadline_passed(uint32_t duration_us);
+
+// DROP policy: how many frames starting at next_frame are already past their
+// deadline (capped at FRAME_SCHEDULER_MAX_CONSECUTIVE_DROPS). Their reads can be cancelled.
+int frame_scheduler_stale_frames(const uint16_t *durations_ms, int next_frame, int total_frames);
+
+// Time spent in a pipeline stage since the last frame_scheduler_wait; used to
+// attribute late and dropped frames.
+void frame_scheduler_stage_time(frame_stage_t stage, uint32_t us);
+
+void frame_scheduler_reset_stats(void);
+
+#endif // __FRAME_SCHEDULER_H__
@@ -0,0 +1,288 @@
+#include "frame_stream.h"
+#include "bsp_co5300.h"
+#include "frame_pack.h"
+#include "playlist.h"
+#include "panel_mask.h"
+#include "ff.h"
+#include "hardware/spi.h"
+
+frame_stream_info_t *g_frame_stream_info;
+
+static uint8_t *s_chunks[FRAME_STREAM_MAX_BUFFERS];
+static int s_next_chunk; // Next buffer in the rotation
+
+// Frame being read: where the next chunk comes from
+static int s_reader_frame = -1;
+static bool s_reader_packed;
+static bool s_reader_open;
+static bool s_reader_ok;
+static uint32_t s_reader_offset; // Bytes of the frame read so far
+static FIL s_fil;
+
+static const panel_mask_band_t *s_open_band; // Mask band whose window is set, NULL at frame start
+static uint32_t s_baud;                      // Display SPI clock, for display_us
+
+// Chunks of s_reader_frame read ahead by frame_stream_preload, oldest first
+static int s_ready_chunk[FRAME_STREAM_MAX_BUFFERS];
+static uint32_t s_ready_bytes[FRAME_STREAM_MAX_BUFFERS];
+static int s_ready_count;
+
+static inline uint32_t frame_bytes(void)
+{
+    return (uint32_t)g_frame_stream_info->width * g_frame_stream_info->height;
+}
+
+static void wait_flush(void)
+{
+    frame_stream_info_t *info = g_frame_stream_info;
+    uint32_t t0 = time_us_32();
+    while (!*info->flush_done)
+    {
+        tight_loop_contents();
+    }
+    info->wait_us += time_us_32() - t0;
+}
+
+static void send(uint8_t *buf, uint32_t bytes)
+{
+    wait_flush();
+    *g_frame_stream_info->flush_done = false;
+    bsp_co5300_flush(buf, bytes);
+    g_frame_stream_info->display_us += (uint64_t)bytes * 8 * 1000000 / s_baud;
+}
+
+// Sends a chunk (frame bytes [offset, offset + bytes)) cropped to the panel mask:
+// each row's visible columns are moved to the front of buf in place and sent as
+// one flush per band the chunk touches. The DMA only ever reads below the write
+// position, so packing can go on while it runs.
+static void send_masked(uint8_t *buf, uint32_t offset, uint32_t bytes)
+{
+    uint32_t width = g_frame_stream_info->width;
+    uint32_t packed = 0;
+    uint32_t segment = 0; // Start of the packed bytes not yet sent
+
+    for (uint32_t pos = offset; pos < offset + bytes;)
+    {
+        int row = pos / width;
+        uint32_t row_start = row * width;
+        uint32_t piece_end = row_start + width < offset + bytes ? row_start + width : offset + bytes;
+
+        const panel_mask_band_t *band = panel_mask_band_of_row(row);
+        if (band != s_open_band)
+        {
+            if (packed > segment)
+            {
+                send(&buf[segment], packed - segment);
+                segment = packed;
+            }
+            wait_flush();
+            bsp_co5300_set_window(band->x_start, band->y_start, band->x_end - 1, band->y_end - 1);
+            s_open_band = band;
+        }
+
+        uint32_t first = pos - row_start > band->x_start ? pos - row_start : band->x_start;
+        uint32_t end = piece_end - row_start < band->x_end ? piece_end - row_start : band->x_end;
+        if (end > first)
+        {
+            memmove(&buf[packed], &buf[row_start + first - offset], end - first);
+            packed += end - first;
+        }
+        pos = piece_end;
+    }
+    if (packed > segment)
+    {
+        send(&buf[segment], packed - segment);
+    }
+    else if (packed == 0)
+    {
+        // Nothing of this chunk is visible: the DMA is still on the previous buffer,
+        // which the rotation is about to hand out again
+        wait_flush();
+    }
+}
+
+static void reader_close(void)
+{
+    if (s_reader_open)
+    {
+        f_close(&s_fil);
+        s_reader_open = false;
+    }
+    s_reader_frame = -1;
+    s_ready_count = 0;
+}
+
+static void reader_start(int frame_index)
+{
+    reader_close();
+    s_reader_frame = frame_index;
+    s_reader_offset = 0;
+    s_reader_packed = frame_pack_contains(frame_index);
+    if (!s_reader_packed)
+    {
+        char path[PLAYLIST_MAX_PATH];
+        s_reader_open = playlist_frame_path(frame_index, path, sizeof(path)) && f_open(&s_fil, path, FA_READ) == FR_OK;
+    }
+    s_reader_ok = s_reader_packed || s_reader_open;
+}
+
+// Reads the next chunk of the frame into buf. After a read error the rest of
+// the frame comes back black so the panel's write pointer stays in step.
+static uint32_t reader_next(uint8_t *buf)
+{
+    frame_stream_info_t *info = g_frame_stream_info;
+    uint32_t chunk_bytes = info->chunk_sectors * FRAME_STREAM_SECTOR;
+    uint32_t left = frame_bytes() - s_reader_offset;
+    uint32_t bytes = left < chunk_bytes ? left : chunk_bytes;
+
+    if (s_reader_ok)
+    {
+        uint32_t t0 = time_us_32();
+        if (s_reader_packed)
+        {
+            // Slots are padded to whole sectors, so the last chunk can read past the frame
+            s_reader_ok = frame_pack_read_sectors(s_reader_frame, s_reader_offset / FRAME_STREAM_SECTOR,
+                                                  (bytes + FRAME_STREAM_SECTOR - 1) / FRAME_STREAM_SECTOR, buf);
+        }
+        else
+        {
+            UINT bytes_read;
+            s_reader_ok = f_read(&s_fil, buf, bytes, &bytes_read) == FR_OK && bytes_read == bytes;
+        }
+        info->read_us += time_us_32() - t0;
+    }
+    if (!s_reader_ok)
+    {
+        memset(buf, 0x00, bytes);
+    }
+    s_reader_offset += bytes;
+    return bytes;
+}
+
+bool frame_stream_init(frame_stream_info_t *stream_info)
+{
+    g_frame_stream_info = stream_info;
+
+    if (stream_info->chunk_sectors < 1)
+        stream_info->chunk_sectors = 1;
+    if (stream_info->buffers < 2)
+        stream_info->buffers = 2;
+    if (stream_info->buffers > FRAME_STREAM_MAX_BUFFERS)
+        stream_info->buffers = FRAME_STREAM_MAX_BUFFERS;
+
+    size_t chunk_bytes = (size_t)stream_info->chunk_sectors * FRAME_STREAM_SECTOR;
+    if (stream_info->pool == NULL || stream_info->pool_size < stream_info->buffers * chunk_bytes)
+    {
+        printf("Stream: %u %u-sector chunks don't fit a %u-byte pool\n", stream_info->buffers,
+               stream_info->chunk_sectors, (unsigned)stream_info->pool_size);
+        return false;
+    }
+    for (int i = 0; i < stream_info->buffers; i++)
+    {
+        s_chunks[i] = &stream_info->pool[i * chunk_bytes];
+    }
+    s_next_chunk = 0;
+    reader_close();
+
+    frame_stream_reset_stats();
+    return true;
+}
+
+frame_stream_info_t *frame_stream_get_info(void)
+{
+    return g_frame_stream_info;
+}
+
+void frame_stream_reset_stats(void)
+{
+    frame_stream_info_t *info = g_frame_stream_info;
+    info->frames = 0;
+    info->failures = 0;
+    info->preloaded = 0;
+    info->read_us = 0;
+    info->display_us = 0;
+    info->wait_us = 0;
+    info->stream_us = 0;
+}
+
+void frame_stream_preload(int frame_index)
+{
+    frame_stream_info_t *info = g_frame_stream_info;
+    uint32_t t0 = time_us_32();
+    if (s_reader_frame != frame_index)
+    {
+        reader_start(frame_index);
+    }
+
+    // The buffer the DMA is sending from was taken last; every other one is free
+    while (s_ready_count < info->buffers - 1 && s_reader_offset < frame_bytes())
+    {
+        int chunk = s_next_chunk;
+        s_next_chunk = (s_next_chunk + 1) % info->buffers;
+        s_ready_chunk[s_ready_count] = chunk;
+        s_ready_bytes[s_ready_count] = reader_next(s_chunks[chunk]);
+        s_ready_count++;
+    }
+    info->stream_us += time_us_32() - t0;
+}
+
+bool frame_stream_present(int frame_index)
+{
+    frame_stream_info_t *info = g_frame_stream_info;
+    uint32_t t0 = time_us_32();
+    s_baud = spi_get_baudrate(BSP_CO5300_SPI_NUM);
+
+    if (s_reader_frame != frame_index)
+    {
+        reader_start(frame_index);
+    }
+    int ready = 0;
+
+    // The window can only change once the previous frame's last chunk is out
+    s_open_band = NULL;
+    if (!info->mask)
+    {
+        wait_flush();
+        bsp_co5300_set_window(info->x, info->y, info->x + info->width - 1, info->y + info->height - 1);
+    }
+
+    for (uint32_t sent = 0; sent < frame_bytes();)
+    {
+        uint8_t *buf;
+        uint32_t bytes;
+        if (ready < s_ready_count)
+        {
+            buf = s_chunks[s_ready_chunk[ready]];
+            bytes = s_ready_bytes[ready];
+            ready++;
+            info->preloaded++;
+        }
+        else
+        {
+            // This buffer's DMA finished before the previous chunk's started
+            buf = s_chunks[s_next_chunk];
+            s_next_chunk = (s_next_chunk + 1) % info->buffers;
+            bytes = reader_next(buf);
+        }
+
+        if (info->mask)
+        {
+            send_masked(buf, sent, bytes);
+        }
+        else
+        {
+            send(buf, bytes);
+        }
+        sent += bytes;
+    }
+
+    bool ok = s_reader_ok;
+    if (!ok)
+    {
+        info->failures++;
+    }
+    reader_close();
+    info->frames++;
+    info->stream_us += time_us_32() - t0;
+    return ok;
+}
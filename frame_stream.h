@@ -0,0 +1,56 @@
+#ifndef __FRAME_STREAM_H__
+#define __FRAME_STREAM_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define FRAME_STREAM_SECTOR 512
+#define FRAME_STREAM_MAX_BUFFERS 3
+
+typedef struct
+{
+    uint16_t x;      // Content rect on the panel
+    uint16_t y;
+    uint16_t width;  // Frames are width * height RGB332 bytes, no scaling
+    uint16_t height;
+    uint16_t chunk_sectors;     // Size of each SD read and display DMA burst
+    uint8_t buffers;            // Chunk buffers in rotation, 2 to FRAME_STREAM_MAX_BUFFERS
+    uint8_t *pool;              // Backing storage for the chunk buffers, word aligned
+    size_t pool_size;           // At least buffers * chunk_sectors * FRAME_STREAM_SECTOR bytes
+    bool mask;                  // Send only the round panel's visible disc (rect must be the panel_mask panel)
+    volatile bool *flush_done;  // Set by the display DMA completion callback
+
+    // Statistics since the last frame_stream_reset_stats()
+    uint32_t frames;
+    uint32_t failures;    // Frames cut short by a read error (the rest of the rect is sent black)
+    uint32_t preloaded;   // Chunks read ahead by frame_stream_preload that were used
+    uint32_t read_us;     // SD bus: blocked on the card
+    uint32_t display_us;  // Display bus: time the bytes sent take on the SPI clock
+    uint32_t wait_us;     // Blocked on the display DMA
+    uint32_t stream_us;   // Wall time in frame_stream_present and frame_stream_preload
+} frame_stream_info_t;
+
+// Carves the chunk buffers from the pool. Returns false if they don't fit.
+bool frame_stream_init(frame_stream_info_t *stream_info);
+frame_stream_info_t *frame_stream_get_info(void);
+
+// Sends one playlist frame straight from the card to the panel. Chunks rotate
+// through the buffers: one is being sent by the display DMA while the next is
+// read from the card. Packed frames are read by raw LBA, others with
+// sector-aligned f_reads that FatFS hands to disk_read without going through
+// its own buffer. With mask set, the visible part of each row is packed to the
+// front of the chunk in place and sent under the panel_mask band windows.
+// Returns with the last chunk's DMA still running.
+bool frame_stream_present(int frame_index);
+
+// Reads the head of frame_index into the buffers the running DMA doesn't use
+// (buffers - 1 chunks), so the next frame_stream_present starts sending at
+// once. Meant for the gap between frames; a different next frame just
+// discards it.
+void frame_stream_preload(int frame_index);
+
+void frame_stream_reset_stats(void);
+
+#endif // __FRAME_STREAM_H__
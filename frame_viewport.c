@@ -0,0 +1,240 @@
+#include "frame_viewport.h"
+#include "bsp_co5300.h"
+#include "frame_pack.h"
+#include "playlist.h"
+#include "panel_mask.h"
+#include "ff.h"
+
+frame_viewport_info_t *g_frame_viewport_info;
+
+static uint8_t *s_window;     // Sectors [s_window_first, s_window_first + count) of the frame
+static uint8_t *s_lines[2];   // Scaled output lines, one being sent while the other is built
+static uint16_t *s_x_lut;     // Output column -> source column within the view
+static uint32_t s_window_first;
+static int s_window_rows[2];  // Source rows [first, end) held in s_window
+
+static inline uint32_t row_begin(int row)
+{
+    frame_viewport_info_t *info = g_frame_viewport_info;
+    return (uint32_t)row * info->src_width + info->x;
+}
+
+static inline uint32_t row_end(int row)
+{
+    return row_begin(row) + g_frame_viewport_info->view_width;
+}
+
+static void wait_flush(void)
+{
+    while (!*g_frame_viewport_info->flush_done)
+    {
+        tight_loop_contents();
+    }
+}
+
+bool frame_viewport_init(frame_viewport_info_t *viewport_info)
+{
+    g_frame_viewport_info = viewport_info;
+
+    if (viewport_info->chunk_sectors < 2)
+        viewport_info->chunk_sectors = 2; // A row under 512 bytes can straddle two sectors
+
+    // window_load reads at least one whole row: the widest view (1:1, or all of a
+    // narrower source) must fit the buffer from any offset in its first sector
+    uint32_t widest = viewport_info->out_width < viewport_info->src_width ? viewport_info->out_width : viewport_info->src_width;
+    uint32_t row_sectors = (widest + FRAME_VIEWPORT_SECTOR - 2) / FRAME_VIEWPORT_SECTOR + 1;
+    if (widest == 0 || row_sectors > viewport_info->chunk_sectors)
+    {
+        printf("Viewport: a %u-pixel source row needs %u sectors, buffer holds %u\n",
+               widest, row_sectors, viewport_info->chunk_sectors);
+        return false;
+    }
+
+    // Window, two lines and the column LUT, each word aligned
+    uint32_t window_bytes = viewport_info->chunk_sectors * FRAME_VIEWPORT_SECTOR;
+    uint32_t line_bytes = (viewport_info->out_width + 3u) & ~3u;
+    uint32_t lut_bytes = (viewport_info->out_width * sizeof(uint16_t) + 3u) & ~3u;
+    if (viewport_info->pool == NULL || viewport_info->pool_size < window_bytes + 2 * line_bytes + lut_bytes)
+    {
+        printf("Viewport: buffers need %u bytes, pool has %u\n", (unsigned)(window_bytes + 2 * line_bytes + lut_bytes),
+               (unsigned)viewport_info->pool_size);
+        return false;
+    }
+    s_window = viewport_info->pool;
+    s_lines[0] = &s_window[window_bytes];
+    s_lines[1] = &s_lines[0][line_bytes];
+    s_x_lut = (uint16_t *)&s_lines[1][line_bytes];
+
+    frame_viewport_set(0, 0, FRAME_VIEWPORT_ZOOM_ONE);
+    frame_viewport_reset_stats();
+    return true;
+}
+
+frame_viewport_info_t *frame_viewport_get_info(void)
+{
+    return g_frame_viewport_info;
+}
+
+void frame_viewport_reset_stats(void)
+{
+    frame_viewport_info_t *info = g_frame_viewport_info;
+    info->frames = 0;
+    info->failures = 0;
+    info->reads = 0;
+    info->sectors_read = 0;
+    info->read_us = 0;
+}
+
+void frame_viewport_set(int x, int y, uint16_t zoom_q8)
+{
+    frame_viewport_info_t *info = g_frame_viewport_info;
+
+    if (zoom_q8 < FRAME_VIEWPORT_ZOOM_ONE)
+        zoom_q8 = FRAME_VIEWPORT_ZOOM_ONE;
+    uint32_t view_width = ((uint32_t)info->out_width * FRAME_VIEWPORT_ZOOM_ONE + zoom_q8 - 1) / zoom_q8;
+    uint32_t view_height = ((uint32_t)info->out_height * FRAME_VIEWPORT_ZOOM_ONE + zoom_q8 - 1) / zoom_q8;
+    if (view_width > info->src_width)
+        view_width = info->src_width;
+    if (view_height > info->src_height)
+        view_height = info->src_height;
+
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+    if (x > info->src_width - (int)view_width)
+        x = info->src_width - view_width;
+    if (y > info->src_height - (int)view_height)
+        y = info->src_height - view_height;
+
+    info->x = x;
+    info->y = y;
+    info->zoom_q8 = zoom_q8;
+    info->view_width = view_width;
+    info->view_height = view_height;
+
+    for (int i = 0; i < info->out_width; i++)
+    {
+        uint32_t sx = (uint32_t)i * FRAME_VIEWPORT_ZOOM_ONE / zoom_q8;
+        s_x_lut[i] = sx < view_width ? sx : view_width - 1;
+    }
+}
+
+// Reads the sectors under `row` plus as many following viewport rows as fit the
+// buffer without skipping more than FRAME_VIEWPORT_MERGE_GAP unused sectors
+static bool window_load(int frame_index, bool packed, FIL *fil, int row)
+{
+    frame_viewport_info_t *info = g_frame_viewport_info;
+    int view_end = info->y + info->view_height;
+    uint32_t first = row_begin(row) / FRAME_VIEWPORT_SECTOR;
+    uint32_t last = (row_end(row) - 1) / FRAME_VIEWPORT_SECTOR;
+    int end = row + 1;
+
+    for (; end < view_end; end++)
+    {
+        uint32_t next_first = row_begin(end) / FRAME_VIEWPORT_SECTOR;
+        uint32_t next_last = (row_end(end) - 1) / FRAME_VIEWPORT_SECTOR;
+        if (next_last - first + 1 > info->chunk_sectors || next_first > last + 1 + FRAME_VIEWPORT_MERGE_GAP)
+            break;
+        last = next_last;
+    }
+
+    uint32_t count = last - first + 1;
+    uint32_t t0 = time_us_32();
+    bool ok;
+    if (packed)
+    {
+        ok = frame_pack_read_sectors(frame_index, first, count, s_window);
+    }
+    else
+    {
+        // The file ends mid-sector; only the bytes up to the last row's end must be there
+        UINT bytes_read;
+        uint32_t needed = row_end(end - 1) - first * FRAME_VIEWPORT_SECTOR;
+        ok = f_lseek(fil, (FSIZE_t)first * FRAME_VIEWPORT_SECTOR) == FR_OK &&
+             f_read(fil, s_window, count * FRAME_VIEWPORT_SECTOR, &bytes_read) == FR_OK && bytes_read >= needed;
+    }
+    info->read_us += time_us_32() - t0;
+    info->reads++;
+    info->sectors_read += count;
+
+    s_window_first = first;
+    s_window_rows[0] = row;
+    s_window_rows[1] = ok ? end : row;
+    return ok;
+}
+
+bool frame_viewport_present(int frame_index)
+{
+    frame_viewport_info_t *info = g_frame_viewport_info;
+    bool packed = frame_pack_contains(frame_index);
+    bool opened = false;
+    bool ok = true;
+    FIL fil;
+
+    if (!packed)
+    {
+        char path[PLAYLIST_MAX_PATH];
+        opened = playlist_frame_path(frame_index, path, sizeof(path)) && f_open(&fil, path, FA_READ) == FR_OK;
+        ok = opened;
+    }
+    s_window_rows[0] = s_window_rows[1] = -1;
+
+    if (!info->mask)
+    {
+        wait_flush();
+        bsp_co5300_set_window(info->out_x, info->out_y, info->out_x + info->out_width - 1, info->out_y + info->out_height - 1);
+    }
+
+    for (int out_row = 0; out_row < info->out_height; out_row++)
+    {
+        uint32_t sy = (uint32_t)out_row * FRAME_VIEWPORT_ZOOM_ONE / info->zoom_q8;
+        int row = info->y + (sy < info->view_height ? sy : info->view_height - 1);
+        uint8_t *line = s_lines[out_row & 1]; // Its DMA finished before the other line's started
+        int first = 0;
+        int end = info->out_width;
+        const panel_mask_band_t *band = NULL;
+        if (info->mask)
+        {
+            band = panel_mask_band_of_row(out_row);
+            first = band->x_start;
+            end = band->x_end;
+        }
+
+        if (ok && (row < s_window_rows[0] || row >= s_window_rows[1]))
+        {
+            ok = window_load(frame_index, packed, &fil, row);
+        }
+        if (ok)
+        {
+            const uint8_t *src = &s_window[row_begin(row) - s_window_first * FRAME_VIEWPORT_SECTOR];
+            for (int i = first; i < end; i++)
+            {
+                line[i] = src[s_x_lut[i]];
+            }
+        }
+        else
+        {
+            memset(&line[first], 0x00, end - first);
+        }
+
+        wait_flush();
+        if (band != NULL && out_row == band->y_start)
+        {
+            bsp_co5300_set_window(band->x_start, band->y_start, band->x_end - 1, band->y_end - 1);
+        }
+        *info->flush_done = false;
+        bsp_co5300_flush(&line[first], end - first);
+    }
+
+    if (opened)
+    {
+        f_close(&fil);
+    }
+    if (!ok)
+    {
+        info->failures++;
+    }
+    info->frames++;
+    return ok;
+}
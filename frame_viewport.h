@@ -0,0 +1,59 @@
+#ifndef __FRAME_VIEWPORT_H__
+#define __FRAME_VIEWPORT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define FRAME_VIEWPORT_SECTOR 512
+#define FRAME_VIEWPORT_ZOOM_ONE 256  // zoom_q8 for 1:1
+#define FRAME_VIEWPORT_MERGE_GAP 2   // Unused sectors worth reading to save a separate SD command
+
+typedef struct
+{
+    uint16_t src_width;  // Source frames, RGB332 row-major
+    uint16_t src_height;
+    uint16_t out_x;      // Panel rect the viewport is scaled into
+    uint16_t out_y;
+    uint16_t out_width;
+    uint16_t out_height;
+    uint16_t chunk_sectors;     // Read buffer size
+    uint8_t *pool;              // Backing storage for the read buffer, line buffers and column LUT, word aligned
+    size_t pool_size;           // chunk_sectors sectors plus about 4 * out_width bytes
+    bool mask;                  // Build and send only the round panel's visible disc (output must be the panel_mask panel)
+    volatile bool *flush_done;  // Set by the display DMA completion callback
+
+    // Current viewport, set with frame_viewport_set()
+    uint16_t x;       // Top-left source pixel
+    uint16_t y;
+    uint16_t zoom_q8; // Output pixels per source pixel, 8.8 fixed point, >= FRAME_VIEWPORT_ZOOM_ONE
+    uint16_t view_width;  // Source pixels covered
+    uint16_t view_height;
+
+    // Statistics since the last frame_viewport_reset_stats()
+    uint32_t frames;
+    uint32_t failures;
+    uint32_t reads;        // SD commands issued
+    uint32_t sectors_read;
+    uint32_t read_us;
+} frame_viewport_info_t;
+
+// Carves the read buffer and line buffers from the pool. Returns false if they don't fit,
+// or if chunk_sectors can't hold the widest source row the view can cover.
+bool frame_viewport_init(frame_viewport_info_t *viewport_info);
+frame_viewport_info_t *frame_viewport_get_info(void);
+
+// Moves the viewport. Zoom is clamped to at least 1:1 and the view to the source.
+void frame_viewport_set(int x, int y, uint16_t zoom_q8);
+
+// Reads only the sectors under the viewport's rows (one read per run of rows,
+// split where the unused gap between rows is wider than FRAME_VIEWPORT_MERGE_GAP
+// sectors) and sends them nearest-neighbour scaled to the output rect. With
+// mask set each line is built and sent only over its panel_mask band.
+// Returns with the last line's DMA still running.
+bool frame_viewport_present(int frame_index);
+
+void frame_viewport_reset_stats(void);
+
+#endif // __FRAME_VIEWPORT_H__
@@ -17,6 +17,17 @@ This script will:
 - Drop frames with stride (default 1, customizable)
 - Optimize/compress them
 - Save them to the output directory as RGB332 .bin files
+- Record each frame's display duration (GIF delay or 1/fps) in manifest.txt
+
+manifest.txt has one line per frame: "<file>.bin <duration_ms>". A duration of 0
+means the source had no timing and the player shows the frame as soon as it can.
+
+index.bin holds the same playlist as fixed-size little-endian records so the
+player can load it without parsing text (layout must match playlist.h):
+    header: magic "PLIX", u16 version, u16 clip_count, u16 frame_count, u16 reserved
+    clip:   u32 FNV-1a(name), u16 first_frame, u16 frame_count, char name[24]
+    frame:  u16 clip, u16 file_index, u16 duration_ms, u16 reserved, u32 file_size, u32 cluster_hint
+cluster_hint is 0: where a file lands on the card isn't known until it is copied.
 """
 
 import os
@@ -25,6 +36,12 @@ from PIL import Image
 import imageio
 import struct # Added for packing binary data
 
+INDEX_MAGIC = b'PLIX'
+INDEX_VERSION = 1
+INDEX_NAME_LEN = 24 # Including the NUL, see PLAYLIST_NAME_LEN
+INDEX_MAX_CLIPS = 32
+INDEX_MAX_FRAMES = 1024
+
 def crop_and_resize(img, size=(20, 20)):
     # Resize to fill, then center-crop
     aspect = img.width / img.height
@@ -43,10 +60,23 @@ def crop_and_resize(img, size=(20, 20)):
     img = img.crop((left, top, left + size[0], top + size[1]))
     return img
 
+def frame_duration_ms(reader, index):
+    """Display time of one frame in ms: 1/fps for video, the per-frame delay for GIFs, 0 if unknown."""
+    try:
+        meta = reader.get_meta_data(index=index)
+    except (IndexError, ValueError, RuntimeError):
+        meta = reader.get_meta_data()
+    if meta.get('fps'):
+        # Video metadata also carries 'duration', but that is the whole clip in seconds
+        return int(round(1000.0 / meta['fps']))
+    if meta.get('duration'):
+        return int(round(meta['duration']))
+    return 0
+
 def process_media_file(input_path, output_dir, rgb332_palette_img, size=(466, 466), rotation=None, max_frames=None):
     reader = imageio.get_reader(input_path)
     base_name = os.path.splitext(os.path.basename(input_path))[0]
-    generated_files = [] # List to store generated filenames
+    generated_files = [] # List of (filename, duration_ms, clip_name, file_index, file_size) tuples
     
     frame_count = 0
     for i, frame_data in enumerate(reader):
@@ -89,14 +119,48 @@ def process_media_file(input_path, output_dir, rgb332_palette_img, size=(466, 46
             f_bin.write(pixel_data_bin)
             
         print(f"Saved frame {i} as RGB332 .bin: {out_path}")
-        # Store the filename relative to the manifest file itself
-        generated_files.append(f"{base_name}-{i}.bin")
+        # Store the filename relative to the manifest file itself, with its display time
+        generated_files.append((f"{base_name}-{i}.bin", frame_duration_ms(reader, i), base_name, i, len(pixel_data_bin)))
         frame_count += 1
         
     reader.close()
     if frame_count == 0:
         print(f"No frames processed from {input_path}")
-    return generated_files # Return the list of generated filenames
+    return generated_files # Return the list of (filename, duration_ms, clip_name, file_index, file_size)
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+def write_index(index_path, frame_files):
+    """Writes the binary playlist index. Returns False if the playlist doesn't fit its limits, after removing any
+    index.bin left from an earlier run: the player reads index.bin before manifest.txt, so a stale one would win."""
+    clips = [] # [name, first_frame, frame_count]
+    for _, _, clip_name, _, _ in frame_files:
+        if not clips or clips[-1][0] != clip_name:
+            clips.append([clip_name, len(clips) and clips[-1][1] + clips[-1][2], 0])
+        clips[-1][2] += 1
+
+    too_long = [c[0] for c in clips if len(c[0].encode('utf-8')) >= INDEX_NAME_LEN]
+    if too_long or len(clips) > INDEX_MAX_CLIPS or len(frame_files) > INDEX_MAX_FRAMES:
+        print(f"Not writing {index_path}: more than {INDEX_MAX_CLIPS} clips, {INDEX_MAX_FRAMES} frames "
+              f"or names of {INDEX_NAME_LEN} bytes or more ({', '.join(too_long)}). The player will parse manifest.txt.")
+        if os.path.exists(index_path):
+            os.remove(index_path)
+            print(f"Removed the old {index_path}.")
+        return False
+
+    with open(index_path, 'wb') as f:
+        f.write(INDEX_MAGIC + struct.pack('<HHHH', INDEX_VERSION, len(clips), len(frame_files), 0))
+        for name, first_frame, frame_count in clips:
+            name_bytes = name.encode('utf-8')
+            f.write(struct.pack(f'<IHH{INDEX_NAME_LEN}s', fnv1a(name_bytes), first_frame, frame_count, name_bytes))
+        clip_of_name = {c[0]: n for n, c in enumerate(clips)}
+        for _, duration_ms, clip_name, file_index, file_size in frame_files:
+            f.write(struct.pack('<HHHHII', clip_of_name[clip_name], file_index, min(duration_ms, 0xFFFF), 0, file_size, 0))
+    return True
 
 def main():
     parser = argparse.ArgumentParser(description="Convert GIFs to raw RGB332 binary frames and generate a manifest.txt.")
@@ -139,7 +203,7 @@ def main():
         output_size = (466, 466)
 
     os.makedirs(args.output, exist_ok=True)
-    all_frame_files = [] # List to store all frame filenames from all GIFs
+    all_frame_files = [] # (filename, duration_ms, clip_name, file_index, file_size) for every frame from all GIFs
     for fname in os.listdir(args.source):
         if fname.lower().endswith(('.gif', '.mp4')):
             in_path = os.path.join(args.source, fname)
@@ -150,10 +214,14 @@ def main():
     if all_frame_files:
         manifest_path = os.path.join(args.output, 'manifest.txt')
         with open(manifest_path, 'w') as mf:
-            for frame_file_rel_path in all_frame_files:
+            for frame_file_rel_path, duration_ms, _, _, _ in all_frame_files:
                 # Ensure path separator is '/' and correct newline
-                mf.write(frame_file_rel_path.replace(os.path.sep, '/') + '\n')
+                mf.write(f"{frame_file_rel_path.replace(os.path.sep, '/')} {duration_ms}\n")
         print(f"Generated manifest.txt at {manifest_path} with {len(all_frame_files)} entries.")
+
+        index_path = os.path.join(args.output, 'index.bin')
+        if write_index(index_path, all_frame_files):
+            print(f"Generated index.bin at {index_path}.")
     else:
         print("No frames were processed, so no manifest.txt was generated.")
 
@@ -2,6 +2,9 @@
 #include "hardware/spi.h"
 #include "pico/stdlib.h"
 #include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "bsp_co5300_repeat.pio.h"
 
 bsp_co5300_info_t *g_co5300_info;
 
@@ -13,8 +16,38 @@ typedef struct
     unsigned int delay_ms; /*<! Delay in milliseconds after this command */
 } bsp_co5300_cmd_t;
 
+static bool s_pins_on_pio;
+
+// Data pins: SPI for commands and plain data, PIO while the pixel repeater is on
+static void bsp_co5300_pins_to_pio(bool on_pio)
+{
+    if (on_pio == s_pins_on_pio)
+        return;
+    if (on_pio)
+    {
+        pio_gpio_init(BSP_CO5300_REPEAT_PIO, BSP_CO5300_MOSI_PIN);
+        pio_gpio_init(BSP_CO5300_REPEAT_PIO, BSP_CO5300_SCLK_PIN);
+    }
+    else
+    {
+        gpio_set_function(BSP_CO5300_MOSI_PIN, GPIO_FUNC_SPI);
+        gpio_set_function(BSP_CO5300_SCLK_PIN, GPIO_FUNC_SPI);
+    }
+    s_pins_on_pio = on_pio;
+}
+
+// Last repeated byte out: the state machine stalls on its pull once the FIFO is empty
+static void bsp_co5300_repeat_wait_idle(void)
+{
+    uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + g_co5300_info->repeat_sm);
+    BSP_CO5300_REPEAT_PIO->fdebug = stall;
+    while (!(BSP_CO5300_REPEAT_PIO->fdebug & stall))
+        ;
+}
+
 void bsp_co5300_tx_cmd(bsp_co5300_cmd_t *cmds, size_t cmd_len)
 {
+    bsp_co5300_pins_to_pio(false);
     gpio_put(BSP_CO5300_CS_PIN, 0);
     for (int i = 0; i < cmd_len; i++)
     {
@@ -53,9 +86,16 @@ static void bsp_co5300_spi_init(void)
 
 void bsp_co5300_dma_callback(void)
 {
-    // Wait for SPI to finish transmitting everything from its FIFO
-    while (spi_get_hw(BSP_CO5300_SPI_NUM)->sr & SPI_SSPSR_BSY_BITS)
-        ;
+    // Wait for SPI (or the pixel repeater) to finish transmitting everything from its FIFO
+    if (g_co5300_info->pixel_repeat > 1)
+    {
+        bsp_co5300_repeat_wait_idle();
+    }
+    else
+    {
+        while (spi_get_hw(BSP_CO5300_SPI_NUM)->sr & SPI_SSPSR_BSY_BITS)
+            ;
+    }
 
     // sleep_us(1); // Temporarily commenting out sleep_us as well
     gpio_put(BSP_CO5300_CS_PIN, 1);
@@ -98,6 +138,37 @@ static void bsp_co5300_spi_dma_init(void)
         return;
     }
     bsp_dma_channel_irq_add(1, g_co5300_info->dma_tx_channel, bsp_co5300_dma_callback);
+
+    // Chained flushes: the control channel copies {count, read address} into the data
+    // channel's alias 3 registers, the last write triggers it, and the data channel chains
+    // back to the control channel when done. IRQ_QUIET keeps the data channel silent until
+    // the list's NULL read address, which raises one IRQ instead of starting a transfer.
+    g_co5300_info->dma_chain_channel = dma_claim_unused_channel(true);
+    g_co5300_info->dma_ctrl_channel = dma_claim_unused_channel(true);
+
+    c = dma_channel_get_default_config(g_co5300_info->dma_chain_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(BSP_CO5300_SPI_NUM, true));
+    channel_config_set_chain_to(&c, g_co5300_info->dma_ctrl_channel);
+    channel_config_set_irq_quiet(&c, true);
+    dma_channel_configure(g_co5300_info->dma_chain_channel, &c,
+                          &spi_get_hw(BSP_CO5300_SPI_NUM)->dr, // write address
+                          NULL,                                // read address, from the list
+                          0,                                   // element count, from the list
+                          false);                              // don't start yet
+
+    c = dma_channel_get_default_config(g_co5300_info->dma_ctrl_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 3); // Wrap every 8 bytes: TRANS_COUNT, READ_ADDR_TRIG
+    dma_channel_configure(g_co5300_info->dma_ctrl_channel, &c,
+                          &dma_hw->ch[g_co5300_info->dma_chain_channel].al3_transfer_count,
+                          NULL, // read address: the list, set per flush
+                          2,    // one block per trigger
+                          false);
+
+    bsp_dma_channel_irq_add(1, g_co5300_info->dma_chain_channel, bsp_co5300_dma_callback);
 }
 
 static void bsp_co5300_gpio_init(void)
@@ -199,6 +270,7 @@ void bsp_co5300_flush(uint8_t *color, size_t color_len)
     //     bsp_co5300_tx_cmd(&cmd, 1);
     // }
 
+    bsp_co5300_pins_to_pio(g_co5300_info->pixel_repeat > 1);
     if (g_co5300_info->enabled_dma)
     {
         gpio_put(BSP_CO5300_CS_PIN, 0);
@@ -206,6 +278,17 @@ void bsp_co5300_flush(uint8_t *color, size_t color_len)
         dma_channel_set_trans_count(g_co5300_info->dma_tx_channel, color_len, true);
         dma_channel_set_read_addr(g_co5300_info->dma_tx_channel, color, false);
     }
+    else if (g_co5300_info->pixel_repeat > 1)
+    {
+        gpio_put(BSP_CO5300_CS_PIN, 0);
+        gpio_put(BSP_CO5300_DC_PIN, 1);
+        for (size_t i = 0; i < color_len; i++)
+        {
+            pio_sm_put_blocking(BSP_CO5300_REPEAT_PIO, g_co5300_info->repeat_sm, (uint32_t)color[i] << 24);
+        }
+        bsp_co5300_repeat_wait_idle();
+        gpio_put(BSP_CO5300_CS_PIN, 1);
+    }
     else
     {
         gpio_put(BSP_CO5300_CS_PIN, 0);
@@ -215,6 +298,90 @@ void bsp_co5300_flush(uint8_t *color, size_t color_len)
     }
 }
 
+void bsp_co5300_set_pixel_repeat(uint8_t repeat)
+{
+    if (repeat < 1)
+        repeat = 1;
+    if (repeat == g_co5300_info->pixel_repeat)
+        return;
+
+    if (repeat > 1)
+    {
+        if (!g_co5300_info->repeat_ready)
+        {
+            // Two PIO cycles per bit: keep SCLK at or below the SPI's 80 MHz
+            float clk_div = clock_get_hz(clk_sys) / (2.0f * 80 * 1000 * 1000);
+            if (clk_div < 1.0f)
+                clk_div = 1.0f;
+            g_co5300_info->repeat_sm = pio_claim_unused_sm(BSP_CO5300_REPEAT_PIO, true);
+            g_co5300_info->repeat_offset = pio_add_program(BSP_CO5300_REPEAT_PIO, &co5300_repeat_program);
+            co5300_repeat_program_init(BSP_CO5300_REPEAT_PIO, g_co5300_info->repeat_sm, g_co5300_info->repeat_offset,
+                                       BSP_CO5300_MOSI_PIN, BSP_CO5300_SCLK_PIN, clk_div, repeat);
+            g_co5300_info->repeat_ready = true;
+        }
+        else
+        {
+            co5300_repeat_set_count(BSP_CO5300_REPEAT_PIO, g_co5300_info->repeat_sm, g_co5300_info->repeat_offset, repeat);
+        }
+    }
+
+    // Both data channels feed either the SPI or the repeater's TX FIFO
+    if (g_co5300_info->enabled_dma)
+    {
+        volatile void *write_addr = &spi_get_hw(BSP_CO5300_SPI_NUM)->dr;
+        uint dreq = spi_get_dreq(BSP_CO5300_SPI_NUM, true);
+        if (repeat > 1)
+        {
+            write_addr = &BSP_CO5300_REPEAT_PIO->txf[g_co5300_info->repeat_sm];
+            dreq = pio_get_dreq(BSP_CO5300_REPEAT_PIO, g_co5300_info->repeat_sm, true);
+        }
+        uint channels[2] = {g_co5300_info->dma_tx_channel, g_co5300_info->dma_chain_channel};
+        for (int i = 0; i < 2; i++)
+        {
+            dma_channel_config c = dma_get_channel_config(channels[i]);
+            channel_config_set_dreq(&c, dreq);
+            dma_channel_set_config(channels[i], &c, false);
+            dma_channel_set_write_addr(channels[i], write_addr, false);
+        }
+    }
+    g_co5300_info->pixel_repeat = repeat;
+}
+
+void bsp_co5300_flush_chain(const bsp_co5300_dma_block_t *blocks)
+{
+    bsp_co5300_pins_to_pio(g_co5300_info->pixel_repeat > 1);
+    if (g_co5300_info->enabled_dma)
+    {
+        gpio_put(BSP_CO5300_CS_PIN, 0);
+        gpio_put(BSP_CO5300_DC_PIN, 1);
+        dma_channel_set_read_addr(g_co5300_info->dma_ctrl_channel, blocks, true);
+    }
+    else
+    {
+        gpio_put(BSP_CO5300_CS_PIN, 0);
+        gpio_put(BSP_CO5300_DC_PIN, 1);
+        for (; blocks->read_addr != NULL; blocks++)
+        {
+            if (g_co5300_info->pixel_repeat > 1)
+            {
+                for (uint32_t i = 0; i < blocks->transfer_count; i++)
+                {
+                    pio_sm_put_blocking(BSP_CO5300_REPEAT_PIO, g_co5300_info->repeat_sm, (uint32_t)blocks->read_addr[i] << 24);
+                }
+            }
+            else
+            {
+                spi_write_blocking(BSP_CO5300_SPI_NUM, blocks->read_addr, blocks->transfer_count);
+            }
+        }
+        if (g_co5300_info->pixel_repeat > 1)
+        {
+            bsp_co5300_repeat_wait_idle();
+        }
+        gpio_put(BSP_CO5300_CS_PIN, 1);
+    }
+}
+
 void bsp_co5300_set_brightness(uint8_t brightness)
 {
     g_co5300_info->brightness = brightness;
@@ -248,6 +415,8 @@ bsp_co5300_info_t *bsp_co5300_get_info(void)
 void bsp_co5300_init(bsp_co5300_info_t *co5300_info)
 {
     g_co5300_info = co5300_info;
+    co5300_info->pixel_repeat = 1;
+    co5300_info->repeat_ready = false;
 
     bsp_co5300_spi_init();
     bsp_co5300_gpio_init();
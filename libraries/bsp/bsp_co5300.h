@@ -21,8 +21,17 @@
 
 #define BSP_CO5300_PWR_PIN      15
 
+#define BSP_CO5300_REPEAT_PIO   pio1    // Pixel repeater (pio0 is the SDIO driver's default)
 
 
+
+// One entry of a chained flush, laid out like the DMA's alias 3 TRANS_COUNT / READ_ADDR_TRIG pair
+typedef struct
+{
+    uint32_t transfer_count;  // Bytes
+    const uint8_t *read_addr;
+} bsp_co5300_dma_block_t;
+
 typedef struct
 {
     uint16_t width;
@@ -33,6 +42,13 @@ typedef struct
     uint8_t brightness;
 
     uint dma_tx_channel;
+    uint dma_chain_channel; // Data channel reprogrammed by dma_ctrl_channel for bsp_co5300_flush_chain
+    uint dma_ctrl_channel;
+
+    uint8_t pixel_repeat;   // Times each data byte is sent, see bsp_co5300_set_pixel_repeat
+    bool repeat_ready;
+    uint repeat_sm;
+    uint repeat_offset;
 
     bool set_brightness_flag;
     bool enabled_dma;
@@ -50,6 +66,18 @@ void bsp_co5300_set_window(uint16_t x_start, uint16_t y_start, uint16_t x_end, u
 
 void bsp_co5300_flush(uint8_t *color, size_t color_len);
 
+// Sends every block of a list ending in {0, NULL} as one transfer under the current window.
+// A control channel loads each block into the data channel, so there is no CPU work
+// between blocks and dma_flush_done_callback runs once, after the last one. The list and
+// the data must stay untouched until then.
+void bsp_co5300_flush_chain(const bsp_co5300_dma_block_t *blocks);
+
+// Sends every data byte of the following flushes `repeat` times: with repeat > 1 the data
+// pins are handed to a PIO program that shifts each byte out repeatedly (commands still go
+// through the SPI), so horizontally scaled rows can be sent at source resolution. The PIO
+// runs the bits at up to 80 MHz but adds ~2 cycles per byte. The DMA must be idle.
+void bsp_co5300_set_pixel_repeat(uint8_t repeat);
+
 void bsp_co5300_set_brightness(uint8_t brightness);
 void bsp_co5300_set_power(bool on);
 
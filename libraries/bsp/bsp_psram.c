@@ -0,0 +1,173 @@
+#include "bsp_psram.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/structs/qmi.h"
+#include "hardware/structs/xip_ctrl.h"
+
+#define PSRAM_CMD_READ_ID 0x9F
+#define PSRAM_CMD_RESET_ENABLE 0x66
+#define PSRAM_CMD_RESET 0x99
+#define PSRAM_CMD_QUAD_ENABLE 0x35
+#define PSRAM_CMD_QUAD_READ 0xEB
+#define PSRAM_CMD_QUAD_WRITE 0x38
+#define PSRAM_KGD 0x5D // "known good die" byte of the read-ID response
+
+static size_t s_psram_size = 0;
+static size_t s_psram_used = 0;
+
+// Direct-mode QMI access stalls XIP on both chip selects, so everything that
+// touches direct_csr has to run from RAM with interrupts off.
+static size_t __no_inline_not_in_flash_func(bsp_psram_detect)(void)
+{
+    qmi_hw->direct_csr = 10 << QMI_DIRECT_CSR_CLKDIV_LSB | QMI_DIRECT_CSR_EN_BITS | QMI_DIRECT_CSR_AUTO_CS1N_BITS;
+    while (qmi_hw->direct_csr & QMI_DIRECT_CSR_BUSY_BITS)
+        ;
+
+    // Leave QPI mode in case a previous boot left the chip there
+    qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+    qmi_hw->direct_tx = QMI_DIRECT_TX_OE_BITS | QMI_DIRECT_TX_IWIDTH_VALUE_Q << QMI_DIRECT_TX_IWIDTH_LSB | 0xF5;
+    while (qmi_hw->direct_csr & QMI_DIRECT_CSR_BUSY_BITS)
+        ;
+    (void)qmi_hw->direct_rx;
+    qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+
+    // Read ID: command, 3 address bytes, then MFID, KGD, EID
+    uint8_t kgd = 0;
+    uint8_t eid = 0;
+    qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+    for (int i = 0; i < 7; i++)
+    {
+        qmi_hw->direct_tx = (i == 0) ? PSRAM_CMD_READ_ID : 0xFF;
+        while ((qmi_hw->direct_csr & QMI_DIRECT_CSR_TXEMPTY_BITS) == 0)
+            ;
+        while (qmi_hw->direct_csr & QMI_DIRECT_CSR_BUSY_BITS)
+            ;
+        if (i == 5)
+            kgd = qmi_hw->direct_rx;
+        else if (i == 6)
+            eid = qmi_hw->direct_rx;
+        else
+            (void)qmi_hw->direct_rx;
+    }
+    qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+
+    if (kgd != PSRAM_KGD)
+    {
+        qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_EN_BITS;
+        return 0;
+    }
+
+    // Reset, then switch the chip to QPI; each command in its own CS cycle
+    const uint8_t cmds[] = {PSRAM_CMD_RESET_ENABLE, PSRAM_CMD_RESET, PSRAM_CMD_QUAD_ENABLE};
+    for (int i = 0; i < 3; i++)
+    {
+        qmi_hw->direct_csr |= QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        qmi_hw->direct_tx = cmds[i];
+        while (qmi_hw->direct_csr & QMI_DIRECT_CSR_BUSY_BITS)
+            ;
+        qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_ASSERT_CS1N_BITS;
+        for (int j = 0; j < 20; j++)
+        {
+            __asm__ volatile("nop");
+        }
+        (void)qmi_hw->direct_rx;
+    }
+    qmi_hw->direct_csr &= ~QMI_DIRECT_CSR_EN_BITS;
+
+    // EID bits 7:5 encode density: 0 = 2 MB, 1 = 4 MB, 2 = 8 MB
+    uint8_t size_id = eid >> 5;
+    if (eid == 0x26 || size_id == 2)
+        return 8 * 1024 * 1024;
+    if (size_id == 1)
+        return 4 * 1024 * 1024;
+    return 2 * 1024 * 1024;
+}
+
+static void __no_inline_not_in_flash_func(bsp_psram_setup_m1)(void)
+{
+    uint32_t clock_hz = clock_get_hz(clk_sys);
+    int divisor = (clock_hz + BSP_PSRAM_MAX_FREQ_HZ - 1) / BSP_PSRAM_MAX_FREQ_HZ;
+    if (divisor == 1 && clock_hz > 100000000)
+    {
+        divisor = 2;
+    }
+    int rxdelay = divisor;
+    if (clock_hz / divisor > 100000000)
+    {
+        rxdelay += 1;
+    }
+
+    // Max select <= 8 us (units of 64 sys clocks), min deselect >= 18 ns
+    uint32_t clock_period_fs = 1000000000000000ull / clock_hz;
+    int max_select = (125 * 1000000) / clock_period_fs;
+    int min_deselect = (18 * 1000000 + (clock_period_fs - 1)) / clock_period_fs - (divisor + 1) / 2;
+
+    qmi_hw->m[1].timing = 1 << QMI_M1_TIMING_COOLDOWN_LSB |
+                          QMI_M1_TIMING_PAGEBREAK_VALUE_1024 << QMI_M1_TIMING_PAGEBREAK_LSB |
+                          max_select << QMI_M1_TIMING_MAX_SELECT_LSB |
+                          min_deselect << QMI_M1_TIMING_MIN_DESELECT_LSB |
+                          rxdelay << QMI_M1_TIMING_RXDELAY_LSB |
+                          divisor << QMI_M1_TIMING_CLKDIV_LSB;
+
+    qmi_hw->m[1].rfmt = QMI_M1_RFMT_PREFIX_WIDTH_VALUE_Q << QMI_M1_RFMT_PREFIX_WIDTH_LSB |
+                        QMI_M1_RFMT_ADDR_WIDTH_VALUE_Q << QMI_M1_RFMT_ADDR_WIDTH_LSB |
+                        QMI_M1_RFMT_SUFFIX_WIDTH_VALUE_Q << QMI_M1_RFMT_SUFFIX_WIDTH_LSB |
+                        QMI_M1_RFMT_DUMMY_WIDTH_VALUE_Q << QMI_M1_RFMT_DUMMY_WIDTH_LSB |
+                        QMI_M1_RFMT_DATA_WIDTH_VALUE_Q << QMI_M1_RFMT_DATA_WIDTH_LSB |
+                        QMI_M1_RFMT_PREFIX_LEN_VALUE_8 << QMI_M1_RFMT_PREFIX_LEN_LSB |
+                        QMI_M1_RFMT_DUMMY_LEN_VALUE_24 << QMI_M1_RFMT_DUMMY_LEN_LSB;
+    qmi_hw->m[1].rcmd = PSRAM_CMD_QUAD_READ;
+
+    qmi_hw->m[1].wfmt = QMI_M1_WFMT_PREFIX_WIDTH_VALUE_Q << QMI_M1_WFMT_PREFIX_WIDTH_LSB |
+                        QMI_M1_WFMT_ADDR_WIDTH_VALUE_Q << QMI_M1_WFMT_ADDR_WIDTH_LSB |
+                        QMI_M1_WFMT_SUFFIX_WIDTH_VALUE_Q << QMI_M1_WFMT_SUFFIX_WIDTH_LSB |
+                        QMI_M1_WFMT_DUMMY_WIDTH_VALUE_Q << QMI_M1_WFMT_DUMMY_WIDTH_LSB |
+                        QMI_M1_WFMT_DATA_WIDTH_VALUE_Q << QMI_M1_WFMT_DATA_WIDTH_LSB |
+                        QMI_M1_WFMT_PREFIX_LEN_VALUE_8 << QMI_M1_WFMT_PREFIX_LEN_LSB;
+    qmi_hw->m[1].wcmd = PSRAM_CMD_QUAD_WRITE;
+
+    hw_set_bits(&xip_ctrl_hw->ctrl, XIP_CTRL_WRITABLE_M1_BITS);
+}
+
+size_t bsp_psram_init(void)
+{
+    gpio_set_function(BSP_PSRAM_CS_PIN, GPIO_FUNC_XIP_CS1);
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    size_t size = bsp_psram_detect();
+    if (size > 0)
+    {
+        bsp_psram_setup_m1();
+    }
+    restore_interrupts(irq_state);
+
+    s_psram_size = size;
+    s_psram_used = 0;
+    if (size == 0)
+    {
+        printf("PSRAM not detected on CS1 (GPIO %d)\r\n", BSP_PSRAM_CS_PIN);
+    }
+    return size;
+}
+
+size_t bsp_psram_get_size(void)
+{
+    return s_psram_size;
+}
+
+void *bsp_psram_alloc(size_t size)
+{
+    size_t offset = (s_psram_used + 3) & ~(size_t)3;
+    if (offset + size > s_psram_size)
+    {
+        return NULL;
+    }
+    s_psram_used = offset + size;
+    return (void *)(BSP_PSRAM_UNCACHED_BASE + offset);
+}
+
+void bsp_psram_free_all(void)
+{
+    s_psram_used = 0;
+}
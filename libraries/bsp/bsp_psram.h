@@ -0,0 +1,43 @@
+#ifndef __BSP_PSRAM_H__
+#define __BSP_PSRAM_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+// XIP chip-select 1 (APS6404-style QSPI PSRAM). Board dependent: set it with
+// the board, through the BSP_PSRAM_CS_PIN cache variable in CMakeLists.txt.
+// XIP_CS1 is only on GPIO 0, 8, 19 and 47, and GPIO 47 only exists on the
+// RP2350B package, so the default follows the package: 8 on RP2350A boards
+// (e.g. the Feather RP2350), 47 on RP2350B boards (e.g. the Pico Plus 2).
+#ifndef BSP_PSRAM_CS_PIN
+#if PICO_RP2350A
+#define BSP_PSRAM_CS_PIN 8
+#else
+#define BSP_PSRAM_CS_PIN 47
+#endif
+#endif
+#if BSP_PSRAM_CS_PIN != 0 && BSP_PSRAM_CS_PIN != 8 && BSP_PSRAM_CS_PIN != 19 && BSP_PSRAM_CS_PIN != 47
+#error BSP_PSRAM_CS_PIN must be an XIP_CS1 pin: GPIO 0, 8, 19 or 47
+#endif
+#if PICO_RP2350A && BSP_PSRAM_CS_PIN > 29
+#error BSP_PSRAM_CS_PIN: GPIO 47 only exists on the RP2350B package
+#endif
+
+#define BSP_PSRAM_MAX_FREQ_HZ 133000000
+
+// M1 window in the XIP address space. The uncached alias bypasses the XIP
+// cache entirely, so bulk frame traffic never evicts flash code.
+#define BSP_PSRAM_CACHED_BASE 0x11000000u
+#define BSP_PSRAM_UNCACHED_BASE 0x15000000u
+
+// Detects and maps the PSRAM. Returns its size in bytes, or 0 if none answered.
+size_t bsp_psram_init(void);
+size_t bsp_psram_get_size(void);
+
+// Bump allocator over the uncached window; 4-byte aligned, NULL when exhausted.
+void *bsp_psram_alloc(size_t size);
+void bsp_psram_free_all(void);
+
+#endif // __BSP_PSRAM_H__
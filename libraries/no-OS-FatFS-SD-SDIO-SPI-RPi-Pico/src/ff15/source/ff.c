@@ -475,6 +475,29 @@ static BYTE SysLock;				/* System lock flag (0:no mutex, 1:unlocked, 2:locked) *
 #endif
 #endif
 
+#if FF_PATH_CACHE
+#if FF_FS_REENTRANT && !FF_FS_LOCK && FF_VOLUMES > 1
+#error FF_PATH_CACHE on a re-entrant multi-volume configuration needs FF_FS_LOCK (the system mutex guards the cache)
+#endif
+typedef struct {
+	WORD	id;			/* Mount ID of the volume the entry belongs to (0:empty) */
+	BYTE	attr;		/* Object attribute */
+	BYTE	stat;		/* exFAT: object chain status */
+	DWORD	sclust;		/* Object start cluster */
+	FSIZE_t	objsize;	/* Object size */
+	DWORD	dir_sclust;	/* Containing directory start cluster */
+	DWORD	dptr;		/* Offset of the entry in the containing directory */
+	LBA_t	dir_sect;	/* Sector holding the entry */
+	UINT	dir_ofs;	/* Offset of the entry in that sector */
+#if FF_FS_EXFAT
+	DWORD	c_size;		/* exFAT: containing directory size and chain status */
+	DWORD	c_ofs;		/* exFAT: offset of the entry block in the containing directory */
+#endif
+	TCHAR	path[FF_PATH_CACHE_LEN];	/* Absolute path as given to f_open, volume ID stripped */
+} PATHCACHE;
+static PATHCACHE PathCache[FF_PATH_CACHE];	/* Direct-mapped by path hash */
+#endif
+
 #if FF_STR_VOLUME_ID
 #ifdef FF_VOLUME_STRS
 static const char *const VolumeStr[FF_VOLUMES] = {FF_VOLUME_STRS};	/* Pre-defined volume ID */
@@ -1048,6 +1071,69 @@ static void clear_share (	/* Clear all lock entries of the volume */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT sector cache (copies of 1st-FAT sectors that left the window)     */
+/*-----------------------------------------------------------------------*/
+#if FF_FAT_CACHE
+
+static void fcache_flush (
+	FATFS* fs			/* Filesystem object */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < FF_FAT_CACHE; i++) {
+		fs->fcsect[i] = (LBA_t)0 - 1;
+		fs->fcused[i] = 0;
+	}
+	fs->fcclock = 0;
+}
+
+
+static void fcache_store (	/* Copy the window into the cache if it holds a clean 1st-FAT sector */
+	FATFS* fs			/* Filesystem object */
+)
+{
+	UINT i, n;
+
+
+	if (fs->fs_type == 0 || fs->winsect - fs->fatbase >= fs->fsize) return;	/* Not mounted or not a FAT sector */
+	for (i = n = 0; i < FF_FAT_CACHE; i++) {
+		if (fs->fcsect[i] == fs->winsect) {	/* Already cached: refresh it */
+			n = i; break;
+		}
+		if (fs->fcused[i] < fs->fcused[n]) n = i;	/* Otherwise the LRU (or an empty) entry */
+	}
+	memcpy(fs->fcbuf[n], fs->win, SS(fs));
+	fs->fcsect[n] = fs->winsect;
+	fs->fcused[n] = ++fs->fcclock;
+}
+
+
+static int fcache_load (	/* 1:The sector has been copied into the window, 0:Not cached */
+	FATFS* fs,			/* Filesystem object */
+	LBA_t sect			/* Sector to bring into the window */
+)
+{
+	UINT i;
+
+
+	if (fs->fs_type == 0) return 0;
+	for (i = 0; i < FF_FAT_CACHE; i++) {
+		if (fs->fcsect[i] == sect) {
+			memcpy(fs->win, fs->fcbuf[i], SS(fs));
+			fs->fcused[i] = ++fs->fcclock;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#endif	/* FF_FAT_CACHE */
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Move/Flush disk access window in the filesystem object                */
 /*-----------------------------------------------------------------------*/
@@ -1069,6 +1155,9 @@ static FRESULT sync_window (	/* Returns FR_OK or FR_DISK_ERR */
 			res = FR_DISK_ERR;
 		}
 	}
+#if FF_FAT_CACHE
+	if (res == FR_OK) fcache_store(fs);	/* The one place the cache is fed: a clean 1st-FAT sector, just written or only read */
+#endif
 	return res;
 }
 #endif
@@ -1087,6 +1176,15 @@ static FRESULT move_window (	/* Returns FR_OK or FR_DISK_ERR */
 		res = sync_window(fs);		/* Flush the window */
 #endif
 		if (res == FR_OK) {			/* Fill sector window with new data */
+#if FF_FAT_CACHE
+#if FF_FS_READONLY
+			fcache_store(fs);		/* Keep the outgoing FAT sector (sync_window does it otherwise) */
+#endif
+			if (fcache_load(fs, sect)) {	/* The incoming one is cached, no disk access */
+				fs->winsect = sect;
+				return FR_OK;
+			}
+#endif
 			if (disk_read(fs->pdrv, fs->win, sect, 1) != RES_OK) {
 				sect = (LBA_t)0 - 1;	/* Invalidate window if read data is not valid */
 				res = FR_DISK_ERR;
@@ -3425,6 +3523,9 @@ static FRESULT mount_volume (	/* FR_OK(0): successful, !=0: an error occurred */
 	/* Following code attempts to mount the volume. (find an FAT volume, analyze the BPB and initialize the filesystem object) */
 
 	fs->fs_type = 0;					/* Invalidate the filesystem object */
+#if FF_FAT_CACHE
+	fcache_flush(fs);					/* The medium may have been changed */
+#endif
 	stat = disk_initialize(fs->pdrv);	/* Initialize the volume hosting physical drive */
 	if (stat & STA_NOINIT) { 			/* Check if the initialization succeeded */
 		return FR_NOT_READY;			/* Failed to initialize due to no medium or hard error */
@@ -3642,6 +3743,139 @@ static FRESULT validate (	/* Returns FR_OK or FR_INVALID_OBJECT */
 
 
 
+#if FF_PATH_CACHE
+/*-----------------------------------------------------------------------*/
+/* Path lookup cache                                                     */
+/*-----------------------------------------------------------------------*/
+
+static void pcache_flush (void)
+{
+	UINT i;
+
+
+	for (i = 0; i < FF_PATH_CACHE; i++) PathCache[i].id = 0;
+}
+
+
+static PATHCACHE* pcache_slot (	/* Returns the slot for the path or NULL if it is not cacheable */
+	const TCHAR* path	/* Path with the volume ID stripped */
+)
+{
+	DWORD hash = 2166136261;
+	UINT n;
+
+
+	if (*path != '/' && *path != '\\') return 0;	/* Relative paths depend on the current directory */
+	for (n = 0; path[n]; n++) {
+		if (n >= FF_PATH_CACHE_LEN - 1) return 0;
+		hash = (hash ^ (BYTE)path[n]) * 16777619;
+	}
+	return &PathCache[hash % FF_PATH_CACHE];
+}
+
+
+static PATHCACHE* pcache_find (
+	FATFS* fs,			/* Volume the path is on */
+	const TCHAR* path	/* Path with the volume ID stripped */
+)
+{
+	PATHCACHE* pc = pcache_slot(path);
+	UINT n;
+
+
+	if (!pc || pc->id != fs->id) return 0;
+	for (n = 0; pc->path[n] == path[n]; n++) {
+		if (!path[n]) return pc;
+	}
+	return 0;
+}
+
+
+static void pcache_store (
+	FIL* fp,			/* File object just opened read-only */
+	const TCHAR* path,	/* Path with the volume ID stripped */
+	DIR* dj				/* Directory object the file was found with */
+)
+{
+	FATFS *fs = fp->obj.fs;
+	PATHCACHE* pc = pcache_slot(path);
+	UINT n;
+
+
+	if (!pc) return;
+	pc->attr = dj->obj.attr;
+	pc->stat = fp->obj.stat;
+	pc->sclust = fp->obj.sclust;
+	pc->objsize = fp->obj.objsize;
+	pc->dir_sclust = dj->obj.sclust;
+	pc->dptr = dj->dptr;
+#if !FF_FS_READONLY
+	pc->dir_sect = fp->dir_sect;
+	pc->dir_ofs = (UINT)(fp->dir_ptr - fs->win);
+#endif
+#if FF_FS_EXFAT
+	pc->c_size = fp->obj.c_size;
+	pc->c_ofs = fp->obj.c_ofs;
+#endif
+	for (n = 0; path[n]; n++) pc->path[n] = path[n];
+	pc->path[n] = 0;
+	pc->id = fs->id;
+}
+
+
+static FRESULT pcache_open (	/* Opens a file read-only from a cache entry without reading the directory */
+	FIL* fp,			/* Blank file object */
+	FATFS* fs,			/* Volume of the entry */
+	const PATHCACHE* pc	/* Cache entry */
+)
+{
+#if FF_FS_LOCK
+	DIR dj;
+	FRESULT res;
+
+
+	dj.obj.fs = fs;
+	dj.obj.sclust = pc->dir_sclust;
+	dj.dptr = pc->dptr;
+	res = chk_share(&dj, 0);
+	if (res != FR_OK) return res;
+	fp->obj.lockid = inc_share(&dj, 0);
+	if (fp->obj.lockid == 0) return FR_INT_ERR;
+#endif
+#if !FF_FS_READONLY
+	fp->dir_sect = pc->dir_sect;
+	fp->dir_ptr = fs->win + pc->dir_ofs;
+#endif
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {
+		fp->obj.c_scl = pc->dir_sclust;
+		fp->obj.c_size = pc->c_size;
+		fp->obj.c_ofs = pc->c_ofs;
+		fp->obj.stat = pc->stat;
+		fp->obj.n_frag = 0;
+	}
+#endif
+	fp->obj.sclust = pc->sclust;
+	fp->obj.objsize = pc->objsize;
+#if FF_USE_FASTSEEK
+	fp->cltbl = 0;
+#endif
+	fp->obj.fs = fs;
+	fp->obj.id = fs->id;
+	fp->flag = FA_READ;
+	fp->err = 0;
+	fp->sect = 0;
+	fp->fptr = 0;
+#if !FF_FS_READONLY && !FF_FS_TINY
+	memset(fp->buf, 0, sizeof fp->buf);
+#endif
+	return FR_OK;
+}
+#endif	/* FF_PATH_CACHE */
+
+
+
+
 /*---------------------------------------------------------------------------
 
    Public Functions (FatFs API)
@@ -3670,6 +3904,9 @@ FRESULT f_mount (
 	vol = get_ldnumber(&rp);
 	if (vol < 0) return FR_INVALID_DRIVE;
 	cfs = FatFs[vol];			/* Pointer to the filesystem object of the volume */
+#if FF_PATH_CACHE
+	pcache_flush();
+#endif
 
 	if (cfs) {					/* Unregister current filesystem object if regsitered */
 		FatFs[vol] = 0;
@@ -3727,6 +3964,9 @@ FRESULT f_open (
 	DWORD cl, bcs, clst, tm;
 	LBA_t sc;
 	FSIZE_t ofs;
+#endif
+#if FF_PATH_CACHE
+	PATHCACHE* pc;
 #endif
 	DEF_NAMBUF
 
@@ -3738,6 +3978,18 @@ FRESULT f_open (
 	res = mount_volume(&path, &fs, mode);
 	if (res == FR_OK) {
 		dj.obj.fs = fs;
+#if FF_PATH_CACHE
+		if (mode != FA_READ) {
+			pcache_flush();		/* The open may create, truncate or later resize an entry */
+		} else {
+			pc = pcache_find(fs, path);
+			if (pc) {			/* Known path: no directory reads */
+				res = pcache_open(fp, fs, pc);
+				if (res != FR_OK) fp->obj.fs = 0;
+				LEAVE_FF(fs, res);
+			}
+		}
+#endif
 		INIT_NAMBUF(fs);
 		res = follow_path(&dj, path);	/* Follow the file path */
 #if !FF_FS_READONLY	/* Read/Write configuration */
@@ -3896,6 +4148,9 @@ FRESULT f_open (
 #endif
 		}
 
+#if FF_PATH_CACHE
+		if (res == FR_OK && mode == FA_READ) pcache_store(fp, path, &dj);
+#endif
 		FREE_NAMBUF();
 	}
 
@@ -4145,6 +4400,15 @@ FRESULT f_sync (
 	res = validate(&fp->obj, &fs);	/* Check validity of the file object */
 	if (res == FR_OK) {
 		if (fp->flag & FA_MODIFIED) {	/* Is there any change to the file? */
+#if FF_PATH_CACHE					/* Size and allocation in the entry change */
+#if FF_FS_REENTRANT && FF_FS_LOCK
+			if (!ff_mutex_take(FF_VOLUMES)) LEAVE_FF(fs, FR_TIMEOUT);	/* Only the volume is locked here; the cache is shared by all volumes */
+			pcache_flush();				/* Nothing is written before the stale entries are gone */
+			ff_mutex_give(FF_VOLUMES);
+#else
+			pcache_flush();
+#endif
+#endif
 #if !FF_FS_TINY
 			if (fp->flag & FA_DIRTY) {	/* Write-back cached data if needed */
 				if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) LEAVE_FF(fs, FR_DISK_ERR);
@@ -4975,6 +5239,9 @@ FRESULT f_unlink (
 
 	/* Get logical drive */
 	res = mount_volume(&path, &fs, FA_WRITE);
+#if FF_PATH_CACHE
+	pcache_flush();			/* Directory entries change */
+#endif
 	if (res == FR_OK) {
 		dj.obj.fs = fs;
 		INIT_NAMBUF(fs);
@@ -5066,6 +5333,9 @@ FRESULT f_mkdir (
 
 
 	res = mount_volume(&path, &fs, FA_WRITE);	/* Get logical drive */
+#if FF_PATH_CACHE
+	pcache_flush();			/* Directory entries change */
+#endif
 	if (res == FR_OK) {
 		dj.obj.fs = fs;
 		INIT_NAMBUF(fs);
@@ -5152,6 +5422,9 @@ FRESULT f_rename (
 
 	get_ldnumber(&path_new);						/* Snip the drive number of new name off */
 	res = mount_volume(&path_old, &fs, FA_WRITE);	/* Get logical drive of the old object */
+#if FF_PATH_CACHE
+	pcache_flush();			/* Directory entries change */
+#endif
 	if (res == FR_OK) {
 		djo.obj.fs = fs;
 		INIT_NAMBUF(fs);
@@ -5260,6 +5533,9 @@ FRESULT f_chmod (
 
 
 	res = mount_volume(&path, &fs, FA_WRITE);	/* Get logical drive */
+#if FF_PATH_CACHE
+	pcache_flush();			/* Directory entries change */
+#endif
 	if (res == FR_OK) {
 		dj.obj.fs = fs;
 		INIT_NAMBUF(fs);
@@ -5306,6 +5582,9 @@ FRESULT f_utime (
 
 
 	res = mount_volume(&path, &fs, FA_WRITE);	/* Get logical drive */
+#if FF_PATH_CACHE
+	pcache_flush();			/* Directory entries change */
+#endif
 	if (res == FR_OK) {
 		dj.obj.fs = fs;
 		INIT_NAMBUF(fs);
@@ -5907,6 +6186,9 @@ FRESULT f_mkfs (
 	vol = get_ldnumber(&path);					/* Get target logical drive */
 	if (vol < 0) return FR_INVALID_DRIVE;
 	if (FatFs[vol]) FatFs[vol]->fs_type = 0;	/* Clear the fs object if mounted */
+#if FF_PATH_CACHE
+	pcache_flush();
+#endif
 	pdrv = LD2PD(vol);		/* Hosting physical drive */
 	ipart = LD2PT(vol);		/* Hosting partition (0:create as new, 1..:existing partition) */
 
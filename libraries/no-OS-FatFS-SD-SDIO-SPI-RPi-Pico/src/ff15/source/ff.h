@@ -171,6 +171,12 @@ typedef struct {
 #endif
 	LBA_t	winsect;		/* Current sector appearing in the win[] */
 	BYTE	win[FF_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
+#if FF_FAT_CACHE
+	DWORD	fcclock;					/* FAT cache use counter */
+	DWORD	fcused[FF_FAT_CACHE];		/* Last use of each entry */
+	LBA_t	fcsect[FF_FAT_CACHE];		/* Sector held by each entry ((LBA_t)0 - 1:empty) */
+	BYTE	fcbuf[FF_FAT_CACHE][FF_MAX_SS];	/* Copies of 1st-FAT sectors (see FF_FAT_CACHE) */
+#endif
 } FATFS;
 
 
@@ -380,6 +386,7 @@ int ff_mutex_create (int vol);		/* Create a sync object */
 void ff_mutex_delete (int vol);		/* Delete a sync object */
 int ff_mutex_take (int vol);		/* Lock sync object */
 void ff_mutex_give (int vol);		/* Unlock sync object */
+void ff_mutex_stats (int vol, DWORD* contended, DWORD* timeouts);	/* Contention counters (ffsystem.c OS_TYPE 5/6 only) */
 #endif
 
 
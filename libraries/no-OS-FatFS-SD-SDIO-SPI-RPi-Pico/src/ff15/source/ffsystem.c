@@ -39,7 +39,9 @@ void ff_memfree (
 /* Definitions of Mutex                                                   */
 /*------------------------------------------------------------------------*/
 
-#define OS_TYPE	0	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS */
+#ifndef OS_TYPE
+#define OS_TYPE	5	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS, 5:Pico SDK, 6:POSIX threads */
+#endif
 
 
 #if   OS_TYPE == 0	/* Win32 */
@@ -64,6 +66,21 @@ static SemaphoreHandle_t Mutex[FF_VOLUMES + 1];	/* Table of mutex handle */
 #include "cmsis_os.h"
 static osMutexId Mutex[FF_VOLUMES + 1];	/* Table of mutex ID */
 
+#elif OS_TYPE == 5	/* Pico SDK (FF_FS_TIMEOUT in ms) */
+#include "pico/mutex.h"
+static recursive_mutex_t Mutex[FF_VOLUMES];	/* Volume mutexes, recursive so f_forward callbacks may re-enter */
+static mutex_t SysMutex;					/* System mutex (FF_VOLUMES) */
+
+#elif OS_TYPE == 6	/* POSIX threads (FF_FS_TIMEOUT in ms), for host builds */
+#include <pthread.h>
+#include <time.h>
+static pthread_mutex_t Mutex[FF_VOLUMES + 1];	/* Table of mutexes */
+
+#endif
+
+#if OS_TYPE >= 5
+static DWORD Contended[FF_VOLUMES + 1];	/* Takes that found the mutex held (counted under the mutex) */
+static DWORD TimedOut[FF_VOLUMES + 1];	/* Takes that gave up after FF_FS_TIMEOUT (approximate, not locked) */
 #endif
 
 
@@ -106,6 +123,24 @@ int ff_mutex_create (	/* Returns 1:Function succeeded or 0:Could not create the
 	Mutex[vol] = osMutexCreate(osMutex(cmsis_os_mutex));
 	return (int)(Mutex[vol] != NULL);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	if (vol == FF_VOLUMES) {
+		if (!mutex_is_initialized(&SysMutex)) mutex_init(&SysMutex);
+	} else {
+		if (!recursive_mutex_is_initialized(&Mutex[vol])) recursive_mutex_init(&Mutex[vol]);
+	}
+	return 1;
+
+#elif OS_TYPE == 6	/* POSIX threads */
+	pthread_mutexattr_t attr;
+	int rc;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	rc = pthread_mutex_init(&Mutex[vol], &attr);
+	pthread_mutexattr_destroy(&attr);
+	return (int)(rc == 0);
+
 #endif
 }
 
@@ -138,6 +173,12 @@ void ff_mutex_delete (	/* Returns 1:Function succeeded or 0:Could not delete due
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexDelete(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	(void)vol;	/* Pico mutexes need no teardown; ff_mutex_create keeps an initialized one */
+
+#elif OS_TYPE == 6	/* POSIX threads */
+	pthread_mutex_destroy(&Mutex[vol]);
+
 #endif
 }
 
@@ -171,6 +212,41 @@ int ff_mutex_take (	/* Returns 1:Succeeded or 0:Timeout */
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	return (int)(osMutexWait(Mutex[vol], FF_FS_TIMEOUT) == osOK);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	if (vol == FF_VOLUMES) {
+		if (mutex_try_enter(&SysMutex, NULL)) return 1;
+		if (!mutex_enter_timeout_ms(&SysMutex, FF_FS_TIMEOUT)) {
+			TimedOut[vol]++;
+			return 0;
+		}
+	} else {
+		if (recursive_mutex_try_enter(&Mutex[vol], NULL)) return 1;
+		if (!recursive_mutex_enter_timeout_ms(&Mutex[vol], FF_FS_TIMEOUT)) {
+			TimedOut[vol]++;
+			return 0;
+		}
+	}
+	Contended[vol]++;
+	return 1;
+
+#elif OS_TYPE == 6	/* POSIX threads */
+	struct timespec ts;
+
+	if (pthread_mutex_trylock(&Mutex[vol]) == 0) return 1;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += FF_FS_TIMEOUT / 1000;
+	ts.tv_nsec += (long)(FF_FS_TIMEOUT % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	if (pthread_mutex_timedlock(&Mutex[vol], &ts) != 0) {
+		TimedOut[vol]++;
+		return 0;
+	}
+	Contended[vol]++;
+	return 1;
+
 #endif
 }
 
@@ -201,8 +277,40 @@ void ff_mutex_give (
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexRelease(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	if (vol == FF_VOLUMES) {
+		mutex_exit(&SysMutex);
+	} else {
+		recursive_mutex_exit(&Mutex[vol]);
+	}
+
+#elif OS_TYPE == 6	/* POSIX threads */
+	pthread_mutex_unlock(&Mutex[vol]);
+
 #endif
 }
 
+
+
+#if OS_TYPE >= 5
+/*------------------------------------------------------------------------*/
+/* Get Contention Counters                                                */
+/*------------------------------------------------------------------------*/
+/* Not a FatFs hook: lets the application see how often the two cores (or
+/  threads) collided on a volume. vol is 0 to FF_VOLUMES - 1, or FF_VOLUMES
+/  for the system mutex. Either pointer may be NULL.
+*/
+
+void ff_mutex_stats (
+	int vol,			/* Mutex ID */
+	DWORD* contended,	/* Takes that had to wait */
+	DWORD* timeouts		/* Takes that failed with FR_TIMEOUT */
+)
+{
+	if (contended) *contended = Contended[vol];
+	if (timeouts) *timeouts = TimedOut[vol];
+}
+#endif
+
 #endif	/* FF_FS_REENTRANT */
 
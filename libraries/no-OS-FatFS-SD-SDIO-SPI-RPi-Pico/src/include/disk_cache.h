@@ -0,0 +1,46 @@
+/* disk_cache.h
+Optional sector cache between FatFs and the SD driver, implemented in glue.c.
+
+Metadata (isolated single-sector reads: FAT, directories) is kept in a small
+LRU. A run of consecutive single-sector reads is detected as sequential and
+served from one multi-block read-ahead instead. Multi-sector reads go straight
+to the driver. The cache only ever holds clean sectors; writes invalidate.
+
+Callers that read file data by raw LBA (the frame pack) use disk_read_uncached,
+so their single-sector reads don't evict FAT and directory sectors.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "ff.h"
+#include "diskio.h"
+
+// Set from the build (e.g. target_compile_definitions) to enable. 0 disables the cache.
+#ifndef DISK_CACHE_SECTORS
+#define DISK_CACHE_SECTORS 0  // LRU entries for metadata sectors
+#endif
+#ifndef DISK_CACHE_READ_AHEAD
+#define DISK_CACHE_READ_AHEAD 8  // Sectors fetched by one read-ahead (one CMD18)
+#endif
+#ifndef DISK_CACHE_SEQ_THRESHOLD
+#define DISK_CACHE_SEQ_THRESHOLD 2  // Consecutive single-sector reads before reading ahead
+#endif
+
+// disk_ioctl commands (outside the FatFs/MMC/ATA ranges in diskio.h)
+#define DISK_CACHE_GET_STATS 100   // buff: disk_cache_stats_t *
+#define DISK_CACHE_RESET_STATS 101 // buff: unused
+
+typedef struct {
+    uint32_t reads;           // disk_read calls
+    uint32_t sectors;         // Sectors requested
+    uint32_t lru_hits;        // Single-sector reads served from the metadata LRU
+    uint32_t read_ahead_hits; // Single-sector reads served from the read-ahead window
+    uint32_t misses;          // Single-sector reads that went to the card
+    uint32_t read_aheads;     // Multi-block read-aheads issued
+    uint32_t passthrough;     // Multi-sector and uncached reads passed straight to the driver
+    uint32_t invalidations;   // Cached sectors dropped by writes
+} disk_cache_stats_t;
+
+// disk_read that always goes straight to the driver: never served from, and never
+// filling, the LRU or the read-ahead window. Counted in reads, sectors and passthrough.
+DRESULT disk_read_uncached(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count);
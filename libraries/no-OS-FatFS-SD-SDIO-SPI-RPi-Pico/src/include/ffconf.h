@@ -275,7 +275,31 @@
 /      lock control is independent of re-entrancy. */
 
 
-#define FF_FS_REENTRANT	0
+#ifndef FF_PATH_CACHE	/* Overridable from the build (tests/test_ff_cache.c) */
+#define FF_PATH_CACHE	128
+#endif
+#define FF_PATH_CACHE_LEN	48
+/* The option FF_PATH_CACHE sets the number of entries of a path lookup cache
+/  for files opened read-only (0:Disable). An entry keeps the directory entry
+/  information of one absolute path (start cluster, size, containing directory
+/  and directory sector), so opening the same path again reads no directory
+/  sectors. Paths of FF_PATH_CACHE_LEN TCHARs or more are not cached. The cache
+/  is flushed on mount/unmount and by any function that can change a directory
+/  entry. The table is static: with exFAT and FF_LBA64 an entry takes 96 bytes,
+/  so 128 entries cost 12 KB of RAM. */
+
+
+#ifndef FF_FAT_CACHE	/* Overridable from the build (tests/test_ff_cache.c) */
+#define FF_FAT_CACHE	4
+#endif
+/* The option FF_FAT_CACHE sets the number of 1st-FAT sectors each filesystem
+/  object keeps besides win[] (0:Disable). A FAT sector that leaves the window
+/  is copied into an LRU slot, so walking a cluster chain between directory
+/  or bitmap accesses no longer reads the same FAT sector again. Each entry
+/  costs FF_MAX_SS bytes in FATFS. Written FAT sectors update their copy. */
+
+
+#define FF_FS_REENTRANT	1
 #define FF_FS_TIMEOUT	1000
 /* The option FF_FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
@@ -289,6 +313,7 @@
 /      function, must be added to the project. Samples are available in ffsystem.c.
 /
 /  The FF_FS_TIMEOUT defines timeout period in unit of O/S time tick.
+/  (ffsystem.c OS_TYPE 5, Pico SDK, and 6, POSIX threads, take it in ms.)
 */
 
 
@@ -21,15 +21,24 @@ specific language governing permissions and limitations under the License.
 /*-----------------------------------------------------------------------*/
 //
 //
+#include <string.h>
+//
+#include "pico/mutex.h"
+//
 #include "hw_config.h"
 #include "my_debug.h"
 #include "sd_card.h"
 //
 #include "diskio.h" /* Declarations of disk functions */
+#include "disk_cache.h"
 
 #define TRACE_PRINTF(fmt, args...)
 //#define TRACE_PRINTF printf  // task_printf
 
+#if DISK_CACHE_SECTORS > 0
+static void cache_drop_drive(BYTE pdrv);
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -57,6 +66,9 @@ DSTATUS disk_initialize(
 
     sd_card_t *sd_card_p = sd_get_by_num(pdrv);
     if (!sd_card_p) return RES_PARERR;
+#if DISK_CACHE_SECTORS > 0
+    cache_drop_drive(pdrv);  // The card may have been swapped
+#endif
     DSTATUS ds = disk_status(pdrv);
     if (STA_NODISK & ds) 
         return ds;
@@ -87,6 +99,136 @@ static int sdrc2dresult(int sd_rc) {
             }
         }
 
+/*-----------------------------------------------------------------------*/
+/* Sector cache (see disk_cache.h)                                       */
+/*-----------------------------------------------------------------------*/
+
+static disk_cache_stats_t cache_stats;
+
+#if DISK_CACHE_SECTORS > 0
+
+typedef struct {
+    BYTE pdrv;
+    bool valid;
+    LBA_t sector;
+    uint32_t last_used;
+    BYTE data[FF_MAX_SS];
+} cache_entry_t;
+
+static cache_entry_t cache_lru[DISK_CACHE_SECTORS];
+static uint32_t cache_clock;
+
+// FatFs only serialises calls per volume, and raw disk_read callers (the
+// frame pack) bypass it entirely, so the cache has its own lock
+auto_init_mutex(cache_mutex);
+
+// Read-ahead window: DISK_CACHE_READ_AHEAD sectors from ra_sector
+static BYTE ra_data[DISK_CACHE_READ_AHEAD][FF_MAX_SS];
+static BYTE ra_pdrv;
+static LBA_t ra_sector;
+static UINT ra_count;  // 0 when empty
+
+// Sequential detection over single-sector reads
+static BYTE seq_pdrv;
+static LBA_t seq_next;
+static unsigned seq_run;
+
+static cache_entry_t *cache_lookup(BYTE pdrv, LBA_t sector) {
+    for (size_t i = 0; i < DISK_CACHE_SECTORS; ++i) {
+        cache_entry_t *e = &cache_lru[i];
+        if (e->valid && e->pdrv == pdrv && e->sector == sector) return e;
+    }
+    return NULL;
+}
+
+static cache_entry_t *cache_victim(void) {
+    cache_entry_t *victim = &cache_lru[0];
+    for (size_t i = 0; i < DISK_CACHE_SECTORS; ++i) {
+        cache_entry_t *e = &cache_lru[i];
+        if (!e->valid) return e;
+        if (e->last_used < victim->last_used) victim = e;
+    }
+    return victim;
+}
+
+static DRESULT cache_read_sector(sd_card_t *sd_card_p, BYTE pdrv, BYTE *buff, LBA_t sector) {
+    cache_entry_t *e = cache_lookup(pdrv, sector);
+    if (e) {
+        e->last_used = ++cache_clock;
+        memcpy(buff, e->data, FF_MAX_SS);
+        cache_stats.lru_hits++;
+        return RES_OK;
+    }
+    if (ra_count && ra_pdrv == pdrv && sector >= ra_sector && sector < ra_sector + ra_count) {
+        memcpy(buff, ra_data[sector - ra_sector], FF_MAX_SS);
+        cache_stats.read_ahead_hits++;
+        seq_next = sector + 1;
+        return RES_OK;
+    }
+
+    // Miss. Part of a sequential run: fetch the next DISK_CACHE_READ_AHEAD sectors in one go
+    if (seq_pdrv == pdrv && sector == seq_next) {
+        seq_run++;
+    } else {
+        seq_run = 1;
+    }
+    seq_pdrv = pdrv;
+    seq_next = sector + 1;
+    cache_stats.misses++;
+
+    if (seq_run >= DISK_CACHE_SEQ_THRESHOLD) {
+        ra_count = 0;
+        int rc = sd_card_p->read_blocks(sd_card_p, ra_data[0], sector, DISK_CACHE_READ_AHEAD);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == rc) {
+            cache_stats.read_aheads++;
+            ra_pdrv = pdrv;
+            ra_sector = sector;
+            ra_count = DISK_CACHE_READ_AHEAD;
+            memcpy(buff, ra_data[0], FF_MAX_SS);
+            return RES_OK;
+        }
+        // Probably ran off the end of the card: fall back to a single read
+    }
+
+    // Isolated read: most likely FAT or directory, keep it in the LRU
+    e = cache_victim();
+    e->valid = false;
+    int rc = sd_card_p->read_blocks(sd_card_p, e->data, sector, 1);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return sdrc2dresult(rc);
+    e->pdrv = pdrv;
+    e->sector = sector;
+    e->last_used = ++cache_clock;
+    e->valid = true;
+    memcpy(buff, e->data, FF_MAX_SS);
+    return RES_OK;
+}
+
+static void cache_invalidate(BYTE pdrv, LBA_t sector, UINT count) {
+    for (size_t i = 0; i < DISK_CACHE_SECTORS; ++i) {
+        cache_entry_t *e = &cache_lru[i];
+        if (e->valid && e->pdrv == pdrv && e->sector >= sector && e->sector < sector + count) {
+            e->valid = false;
+            cache_stats.invalidations++;
+        }
+    }
+    if (ra_count && ra_pdrv == pdrv && sector < ra_sector + ra_count && ra_sector < sector + count) {
+        ra_count = 0;
+        cache_stats.invalidations++;
+    }
+}
+
+static void cache_drop_drive(BYTE pdrv) {
+    mutex_enter_blocking(&cache_mutex);
+    for (size_t i = 0; i < DISK_CACHE_SECTORS; ++i) {
+        if (cache_lru[i].pdrv == pdrv) cache_lru[i].valid = false;
+    }
+    if (ra_pdrv == pdrv) ra_count = 0;
+    if (seq_pdrv == pdrv) seq_run = 0;
+    mutex_exit(&cache_mutex);
+}
+
+#endif // DISK_CACHE_SECTORS > 0
+
 /*-----------------------------------------------------------------------*/
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
@@ -99,6 +241,39 @@ DRESULT disk_read(BYTE pdrv,  /* Physical drive number to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *sd_card_p = sd_get_by_num(pdrv);
     if (!sd_card_p) return RES_PARERR;
+#if DISK_CACHE_SECTORS > 0
+    mutex_enter_blocking(&cache_mutex);
+    cache_stats.reads++;
+    cache_stats.sectors += count;
+    if (1 == count) {
+        DRESULT dr = cache_read_sector(sd_card_p, pdrv, buff, sector);
+        mutex_exit(&cache_mutex);
+        return dr;
+    }
+    // Multi-sector reads are already one CMD18 and are usually file data that won't be read again
+    cache_stats.passthrough++;
+    mutex_exit(&cache_mutex);
+#else
+    cache_stats.reads++;
+    cache_stats.sectors += count;
+#endif
+    int rc = sd_card_p->read_blocks(sd_card_p, buff, sector, count);
+    return sdrc2dresult(rc);
+}
+
+DRESULT disk_read_uncached(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
+    TRACE_PRINTF(">>> %s\n", __FUNCTION__);
+    sd_card_t *sd_card_p = sd_get_by_num(pdrv);
+    if (!sd_card_p) return RES_PARERR;
+#if DISK_CACHE_SECTORS > 0
+    mutex_enter_blocking(&cache_mutex);
+#endif
+    cache_stats.reads++;
+    cache_stats.sectors += count;
+    cache_stats.passthrough++;
+#if DISK_CACHE_SECTORS > 0
+    mutex_exit(&cache_mutex);
+#endif
     int rc = sd_card_p->read_blocks(sd_card_p, buff, sector, count);
     return sdrc2dresult(rc);
 }
@@ -117,7 +292,15 @@ DRESULT disk_write(BYTE pdrv, /* Physical drive number to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *sd_card_p = sd_get_by_num(pdrv);
     if (!sd_card_p) return RES_PARERR;
+#if DISK_CACHE_SECTORS > 0
+    // Held across the write so a concurrent read can't re-cache the old data
+    mutex_enter_blocking(&cache_mutex);
+    cache_invalidate(pdrv, sector, count);
+    int rc = sd_card_p->write_blocks(sd_card_p, buff, sector, count);
+    mutex_exit(&cache_mutex);
+#else
     int rc = sd_card_p->write_blocks(sd_card_p, buff, sector, count);
+#endif
     return sdrc2dresult(rc);
 }
 
@@ -164,6 +347,12 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive number (0..) */
         case CTRL_SYNC:
             sd_card_p->sync(sd_card_p);
             return RES_OK;
+        case DISK_CACHE_GET_STATS:
+            *(disk_cache_stats_t *)buff = cache_stats;
+            return RES_OK;
+        case DISK_CACHE_RESET_STATS:
+            memset(&cache_stats, 0, sizeof cache_stats);
+            return RES_OK;
         default:
             return RES_PARERR;
     }
@@ -1,10 +1,29 @@
 #include <stdio.h>
 #include <string.h> // For strcpy, etc.
 #include <math.h>   // For M_PI and cosf()
+#include <malloc.h> // mallinfo, for the free heap printed at startup
+#include <unistd.h> // sbrk
 #include "pico/stdlib.h"
 #include "ff.h"         // FatFS library
 #include "sd_card.h"    // SD card driver functions
+#include "diskio.h"     // disk_ioctl for the glue-layer sector cache stats
+#include "disk_cache.h"
 #include "bsp_co5300.h" // CO5300 display driver
+#include "frame_cache.h" // RAM frame cache (raw slots or compressed)
+#include "bsp_psram.h"   // QMI CS1 PSRAM
+#include "prefetch.h"    // Latency-adaptive look-ahead loader
+#include "frame_scheduler.h" // Alarm-driven frame pacing
+#include "playlist.h"        // Clips and frames from manifest.txt
+#include "frame_pack.h"      // Contiguous frame container streamed by LBA
+#include "frame_stream.h"    // SD -> display streaming for clips that can't be cached
+#include "frame_viewport.h"  // Zoom/pan window that reads only the visible rows
+#include "panel_mask.h"      // Visible disc of the round panel
+#include "black_span.h"      // Black runs the panel already shows are not resent
+#include "dirty_rect.h"      // Only the parts of the tile that changed since the last frame
+#include "tile_layout.h"     // Grid of scaled, phased and mirrored tiles from one cached frame
+#include "scanline_fx.h"     // Glitch, palette rotation, fade and scanlines within a CPU budget
+#include "pixel_kernels.h"   // Word-at-a-time blend, fade and fill kernels
+#include "clip_transition.h" // Crossfades between consecutive clips
 
 // Display dimensions (assuming 466x466 based on README)
 #define DISPLAY_WIDTH 466
@@ -14,6 +33,18 @@
 #define SCALED_FRAME_WIDTH 140  // New: Apparent width of each tile
 #define SCALED_FRAME_HEIGHT 140 // New: Apparent height of each tile
 
+// Tile layout: TILE_COLS x TILE_ROWS copies of the cached frame, each SCALED_FRAME_WIDTH x SCALED_FRAME_HEIGHT,
+// centred with TILE_GAP black pixels between them (1x1 is the single centred tile)
+#define TILE_COLS 3
+#define TILE_ROWS 3
+#define TILE_GAP 0
+#define TILE_PHASE_STEP 0 // Frames between consecutive tiles for a staggered animation, 0 = all in sync
+#define TILE_MIRROR 0     // Mirror odd columns horizontally and odd rows vertically (kaleidoscope)
+#if TILE_COLS * SCALED_FRAME_WIDTH + (TILE_COLS - 1) * TILE_GAP > DISPLAY_WIDTH || \
+    TILE_ROWS * SCALED_FRAME_HEIGHT + (TILE_ROWS - 1) * TILE_GAP > DISPLAY_HEIGHT
+#error The tile grid is larger than the display
+#endif
+
 // Updated color definitions for 8-bit RGB332
 #define RED_COLOR 0xE0   // Binary 11100000 (R:111, G:000, B:00)
 #define GREEN_COLOR 0x1C // Binary 00011100 (R:000, G:111, B:00)
@@ -21,21 +52,99 @@
 #define BLACK_COLOR 0x00 // Binary 00000000
 #define WHITE_COLOR 0xFF // Binary 11111111
 
-#define MAX_FILENAME_LEN 64
-#define TOTAL_ANIMATION_FRAMES 100 // User-specified total number of frames
-#define FRAMES_TO_BUFFER 10        // Number of frames to keep in RAM
+#define PLAYLIST_DIR "/output/" // manifest.txt and the .bin frames it lists
+#define PLAYLIST_VERBOSE 0      // Print every clip switch (the periodic stats lines are printed regardless)
+
+// Frame pack: copy the playlist into one contiguous file when it changes, then read frames by raw LBA
+#define FRAME_PACK 1
+#define FRAME_PACK_PATH PLAYLIST_DIR "pack.bin"
+#define FRAMES_TO_BUFFER 10        // Most raw frames to keep in RAM (prefetch slot budget), fewer beside a dirty-rect buffer
+#define FRAME_BYTES (FRAME_WIDTH * FRAME_HEIGHT)
+
+// Full-resolution (DISPLAY_WIDTH x DISPLAY_HEIGHT) clips don't fit a cache slot: stream them
+// from the card straight to the display DMA in sector-sized chunks instead
+#define FRAME_STREAM 1
+#define FRAME_STREAM_CHUNK_SECTORS 32 // 16 KB per SD read / display burst
+#define FRAME_STREAM_BUFFERS 3        // One on the wire, the rest filled from the card
+#define STREAM_FRAME_BYTES (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+
+// Zoom/pan over VIEWPORT_SOURCE_WIDTH x VIEWPORT_SOURCE_HEIGHT clips (streamed, needs FRAME_STREAM):
+// only the sectors under the viewport's rows are read, then scaled up to the full display
+#define FRAME_VIEWPORT 0
+#define FRAME_VIEWPORT_ZOOM_Q8 512     // 2x
+#define FRAME_VIEWPORT_PAN_FRAMES 120  // Frames for one sweep across the source
+#define VIEWPORT_SOURCE_WIDTH DISPLAY_WIDTH
+#define VIEWPORT_SOURCE_HEIGHT DISPLAY_HEIGHT
+#define VIEWPORT_SOURCE_BYTES (VIEWPORT_SOURCE_WIDTH * VIEWPORT_SOURCE_HEIGHT)
+#if FRAME_VIEWPORT && !FRAME_STREAM
+#error FRAME_VIEWPORT needs FRAME_STREAM
+#endif
+
+// The round AMOLED only shows the inscribed disc: send just the visible span of each row,
+// under one window per band of rows (rows join a band while the extra pixels cost less than a window)
+#define PANEL_MASK 1
+#define PANEL_MASK_WINDOW_COST 24 // set_window (3 commands, ~11 bytes plus CS/DC turnarounds) in pixel bytes
+
+// AMOLED black is "pixel off" and the converter composites transparency onto black: composed rows
+// skip black runs the panel already shows, as separate set_window + data bursts, when a run is longer
+// than a window costs. The cost is measured at startup and also used for the mask bands.
+#define BLACK_SPAN 1
+
+// Compose the tile row by row, diff each row against a buffer of what the panel shows and send only
+// the merged changed rects (cut to the mask bands); more than DIRTY_RECT_MAX_RECTS (or no saving) falls
+// back to one full-tile present. The buffer is one tile plus a DMA block per row (178 KB for the 3x3 grid),
+// carved from the end of the frame pool; the cache gets the rest. If that would leave fewer than
+// DIRTY_RECT_MIN_CACHE_SLOTS raw frames, startup says so and frames go out line by line
+#define DIRTY_RECT 1
+#define DIRTY_RECT_MIN_CACHE_SLOTS 4
+
+// With an integer horizontal scale the dirty-rect tile is composed at source width and a PIO program
+// on the display pins sends every pixel GRID_COL_REPEAT times (the row chain already repeats rows)
+#define PIXEL_REPEAT_PIO 1
 
-// Glitch effect parameters // REMOVED
-// #define MAX_TARGET_GLITCH_PROBABILITY 0.005f // REMOVED
-// #define GLITCH_PROBABILITY_PERIOD_SECONDS 500.0f // REMOVED
-// #define MAX_GLITCH_LENGTH (FRAME_WIDTH / 3) // REMOVED
-// #define MAX_GLITCH_OFFSET 4 // REMOVED
-// #define MAX_GLITCH_BLOCK_HEIGHT_LINES 8 // REMOVED
+// Compressed cache: try to hold the whole clip in SRAM, fall back to raw streaming slots if it doesn't fit
+#define FRAME_CACHE_COMPRESSED 1
 
-// Static state for an active glitch block // REMOVED
-// static int s_glitch_lines_remaining = 0; // REMOVED
-// static int s_glitch_start_cpu_block; // REMOVED
-// static int s_glitch_len_block; // REMOVED
+// The one big static buffer, owned by the mode that plays: the stream or viewport buffers for
+// full-resolution clips, otherwise the frame cache
+#define FRAME_POOL_SIZE (256 * 1024)
+
+// Frame pacing: per-frame durations come from manifest.txt ("<file>.bin <ms>"), 0 = as fast as possible
+#define FRAME_PACING_POLICY FRAME_SCHEDULER_POLICY_SLIP // or FRAME_SCHEDULER_POLICY_DROP
+#define FRAME_LATE_THRESHOLD_US 2000
+#define FRAME_DEFAULT_DURATION_MS 0
+
+// PSRAM frame store: on boards with PSRAM on XIP CS1, hold the whole clip raw in PSRAM
+#define PSRAM_FRAME_STORE 0
+#define PSRAM_BENCH 0         // Compare PSRAM->display vs SRAM->display throughput at startup
+#define PSRAM_BENCH_FRAMES 50
+
+// Scanline effects on the composed grid rows. Each effect declares its cost; when composing a frame overruns
+// its budget (the frame's duration, or SCANLINE_FX_BUDGET_US for frames shown as fast as possible) the
+// costliest effect is degraded or switched off, and comes back once frames have room for it again
+#define SCANLINE_FX 1
+#define SCANLINE_FX_BUDGET_US 16667   // 60 FPS
+#define SCANLINE_FX_PALETTE_STEP 0    // Palette rotation per frame, 0 = off
+#define SCANLINE_FX_FADE_LEVEL 8      // 0 (black) .. 8 (off)
+#define SCANLINE_FX_DARKEN_ROWS 0     // Every other row at half brightness
+
+// Crossfade the last CLIP_TRANSITION_FRAMES frames of every clip into the first ones of the next clip, which then
+// plays on from after them. The incoming head is prefetched during the outgoing tail (cached frames only)
+#define CLIP_TRANSITION 1
+#define CLIP_TRANSITION_FRAMES 8
+#define CLIP_TRANSITION_BUDGET_US SCANLINE_FX_BUDGET_US // Deadline of frames shown as fast as possible
+#define CLIP_TRANSITION_BENCH 0      // Play only the transitions, back to back, and check every frame met its deadline
+#define CLIP_TRANSITION_BENCH_LEAD 4 // Plain frames before each tail in the bench
+
+// Pixel kernels: print cycles per pixel of every blend/fade/fill kernel against its reference at startup
+#define PIXEL_KERNELS_BENCH 0
+
+// Glitch effect parameters
+#define MAX_TARGET_GLITCH_PROBABILITY 0.005f // Per row, at the peak of the cycle
+#define GLITCH_PROBABILITY_PERIOD_SECONDS 500.0f
+#define MAX_GLITCH_LENGTH (FRAME_WIDTH / 3)
+#define MAX_GLITCH_OFFSET 4
+#define MAX_GLITCH_BLOCK_HEIGHT_LINES 8
 
 volatile bool dma_transfer_complete = true; // Flag for DMA completion
 
@@ -45,16 +154,248 @@ void dma_done_callback(void)
     dma_transfer_complete = true; // Signal DMA completion
 }
 
-// Helper function to apply a glitch if one is active or start a new one // REMOVED
-// static void apply_glitch_if_active(volatile uint8_t *cpu_buf, volatile uint8_t *dma_buf, float current_glitch_probability)
-// { // REMOVED ENTIRE FUNCTION
-// ... (entire function content removed) ...
-// }
+#if BLACK_SPAN
+static bool row_window_lost; // A split or skipped row left the panel's write pointer elsewhere
+#endif
+
+// Sends display row y from a full-width line. With PANEL_MASK only the row's band of the visible
+// disc goes out, under a window set on the band's first row; otherwise row 0 opens the full screen.
+// With BLACK_SPAN a row with black runs worth skipping goes out as single-row bursts instead, and
+// the next whole row reopens the rest of its window. The previous row's DMA must be finished.
+static void present_row(int y, uint8_t *line)
+{
+    int x_start = 0;
+    int x_end = DISPLAY_WIDTH;
+    int window_last_row = DISPLAY_HEIGHT - 1;
+    bool open_window = y == 0;
+#if PANEL_MASK
+    const panel_mask_band_t *band = panel_mask_band_of_row(y);
+    x_start = band->x_start;
+    x_end = band->x_end;
+    window_last_row = band->y_end - 1;
+    open_window = y == band->y_start;
+#endif
+
+#if BLACK_SPAN
+    black_span_burst_t bursts[BLACK_SPAN_MAX_BURSTS];
+    int burst_count = black_span_plan(y, line, x_start, x_end, bursts);
+    if (burst_count != 1 || bursts[0].x_start != x_start || bursts[0].x_end != x_end)
+    {
+        for (int i = 0; i < burst_count; i++)
+        {
+            while (!dma_transfer_complete)
+            {
+                tight_loop_contents();
+            }
+            bsp_co5300_set_window(bursts[i].x_start, y, bursts[i].x_end - 1, y);
+            dma_transfer_complete = false;
+            bsp_co5300_flush(&line[bursts[i].x_start], bursts[i].x_end - bursts[i].x_start);
+        }
+        row_window_lost = true;
+        return;
+    }
+    if (row_window_lost)
+    {
+        open_window = true;
+        row_window_lost = false;
+    }
+#endif
+
+    if (open_window)
+    {
+        bsp_co5300_set_window(x_start, y, x_end - 1, window_last_row);
+    }
+    dma_transfer_complete = false;
+    bsp_co5300_flush(&line[x_start], x_end - x_start);
+}
+
+// Reads one playlist frame into the frame cache. Returns false if the file is missing, short or doesn't fit.
+// Also used as the prefetch loader for frames streamed during playback.
+static bool load_frame(int frame_index)
+{
+    char path[PLAYLIST_MAX_PATH];
+    FIL fil;
+    UINT bytes_read;
+
+    // The binary index knows each file's size, so wrong-sized frames fail without touching the card
+    const playlist_frame_t *frame = playlist_get_frame(frame_index);
+    if (frame == NULL || (frame->file_size != 0 && frame->file_size != FRAME_BYTES) ||
+        !playlist_frame_path(frame_index, path, sizeof(path)))
+    {
+        return false;
+    }
+    uint8_t *dst = frame_cache_begin_store(frame_index);
+    if (dst == NULL)
+    {
+        return false;
+    }
+
+    // Packed frames skip FatFS entirely: no path lookup, no FAT chain walk
+    if (frame_pack_contains(frame_index))
+    {
+        return frame_pack_read(frame_index, dst) && frame_cache_commit_store(frame_index);
+    }
+
+    FRESULT fr = f_open(&fil, path, FA_READ);
+    if (fr != FR_OK)
+    {
+        return false;
+    }
+    fr = f_read(&fil, dst, FRAME_BYTES, &bytes_read);
+    f_close(&fil);
+    if (fr != FR_OK || bytes_read != FRAME_BYTES)
+    {
+        return false;
+    }
+    return frame_cache_commit_store(frame_index);
+}
+
+// Size of the playlist's frames: from the binary index, else from the first frame file itself
+static uint32_t playlist_frame_bytes(void)
+{
+    const playlist_frame_t *frame = playlist_get_frame(0);
+    if (frame == NULL)
+        return 0;
+    if (frame->file_size != 0)
+        return frame->file_size;
+
+    char path[PLAYLIST_MAX_PATH];
+    FILINFO fno;
+    if (!playlist_frame_path(0, path, sizeof(path)) || f_stat(path, &fno) != FR_OK)
+        return 0;
+    return fno.fsize;
+}
+
+// Loads every frame of the playlist into the cache. Stops at the first frame that is missing or doesn't fit.
+static bool load_whole_clip(int num_frames)
+{
+    for (int i = 0; i < num_frames; i++)
+    {
+        if (!load_frame(i))
+        {
+            printf("Cache full or frame %d missing after %d frames\n", i, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The frame shown after frame_index
+static int next_frame_of(int frame_index, int num_frames)
+{
+#if CLIP_TRANSITION
+    return clip_transition_next(frame_index); // Jumps over the incoming head a crossfade already showed
+#else
+    return (frame_index + 1) % num_frames;
+#endif
+}
+
+// Tops up the look-ahead window behind the frame just shown or dropped
+static void run_prefetch(int current_frame_index, int num_frames, const uint16_t *frame_durations_ms)
+{
+    int next_frame_index = next_frame_of(current_frame_index, num_frames);
+    // Frames a crossfade jumped over were already shown in its blend: leave them out like stale ones
+    int skipped = (next_frame_index - current_frame_index - 1 + num_frames) % num_frames;
+#if CLIP_TRANSITION
+    prefetch_set_min_depth(clip_transition_min_depth(current_frame_index));
+#endif
+    prefetch_run(current_frame_index, num_frames,
+                 skipped + frame_scheduler_stale_frames(frame_durations_ms, next_frame_index, num_frames));
+}
+
+#if CLIP_TRANSITION
+// One line per finished crossfade: its slowest frame against that frame's deadline
+static void print_transition_reports(void)
+{
+    clip_transition_report_t report;
+    while (clip_transition_pop_report(&report))
+    {
+        printf("Transition %s -> %s: %u frames, %u dropped, slowest %u us of %u us, %u over deadline%s\n",
+               playlist_clip_name(report.from_clip), playlist_clip_name(report.to_clip), report.frames, report.dropped,
+               report.max_frame_us, report.deadline_us, report.over_deadline,
+               report.over_deadline || report.dropped ? " - FAILED" : "");
+    }
+}
+#endif
+
+// Heap not yet handed out: the never-used space between the heap top and the stack limit, plus freed blocks
+static size_t heap_free_bytes(void)
+{
+    extern char __StackLimit; // Heap end, from the SDK's linker script
+    struct mallinfo heap = mallinfo();
+    return (size_t)(&__StackLimit - (char *)sbrk(0)) + heap.fordblks;
+}
+
+#if PSRAM_FRAME_STORE && PSRAM_BENCH
+static uint8_t *sram_bench_frame; // FRAME_BYTES of the frame pool, idle while the clip is in PSRAM
+
+static const uint8_t *sram_bench_row(int frame_index, uint16_t row)
+{
+    return &sram_bench_frame[row * FRAME_WIDTH];
+}
+
+// Streams PSRAM_BENCH_FRAMES frames to the display row by row and prints the sustained throughput.
+// Rows go through a ping-pong pair of line buffers, the same way the composer feeds the DMA.
+static void bench_present(const char *label, const uint8_t *(*get_row)(int, uint16_t), int num_frames)
+{
+    static uint8_t bench_lines[2][FRAME_WIDTH];
+    uint32_t fetch_us = 0;
+    uint32_t start_us = time_us_32();
+
+    for (int f = 0; f < PSRAM_BENCH_FRAMES; f++)
+    {
+        while (!dma_transfer_complete)
+        {
+            tight_loop_contents();
+        }
+        bsp_co5300_set_window(0, 0, FRAME_WIDTH - 1, FRAME_HEIGHT - 1);
+
+        for (uint16_t y = 0; y < FRAME_HEIGHT; y++)
+        {
+            uint8_t *line = bench_lines[y & 1];
+            uint32_t fetch_start_us = time_us_32();
+            memcpy(line, get_row(f % num_frames, y), FRAME_WIDTH);
+            fetch_us += time_us_32() - fetch_start_us;
+
+            while (!dma_transfer_complete)
+            {
+                tight_loop_contents();
+            }
+            dma_transfer_complete = false;
+            bsp_co5300_flush(line, FRAME_WIDTH);
+        }
+    }
+    while (!dma_transfer_complete)
+    {
+        tight_loop_contents();
+    }
+
+    uint32_t elapsed_us = time_us_32() - start_us;
+    float bytes = (float)PSRAM_BENCH_FRAMES * FRAME_BYTES;
+    printf("%s: %d frames in %u ms, %.2f MB/s to display, %.2f MB/s fetch\n",
+           label, PSRAM_BENCH_FRAMES, elapsed_us / 1000, bytes / elapsed_us, bytes / (fetch_us ? fetch_us : 1));
+}
+
+static void run_psram_bench(int num_frames, uint8_t *scratch)
+{
+    sram_bench_frame = scratch;
+    for (uint16_t y = 0; y < FRAME_HEIGHT; y++)
+    {
+        memcpy(&sram_bench_frame[y * FRAME_WIDTH], frame_cache_get_row(0, y), FRAME_WIDTH);
+    }
+    bench_present("SRAM ->display", sram_bench_row, 1);
+    bench_present("PSRAM->display", frame_cache_get_row, num_frames);
+
+    frame_cache_info_t *info = frame_cache_get_info();
+    printf("PSRAM staging: %u rows, %u us waiting on DMA\n", info->rows_staged, info->stage_wait_us);
+}
+#endif
 
 int main()
 {
     stdio_init_all();
     sleep_ms(2000);
+    uint32_t startup_start_us = time_us_32(); // Startup is timed from here to the first frame on screen
     printf("MINIMAL HELLO WORLD! Can you see me? (Attempting minimal display init)\n");
 
     // Initialize Display (minimal parameters)
@@ -70,6 +411,34 @@ int main()
     bsp_co5300_init(&display_info);
     printf("Display initialized (or crashed trying).\n");
 
+#if PIXEL_KERNELS_BENCH
+    pixel_kernels_bench(); // Its fill claims the DMA channel; nothing else fills, so playback takes none
+#endif
+
+#if BLACK_SPAN
+    static black_span_info_t span_info = {
+        .width = DISPLAY_WIDTH,
+        .height = DISPLAY_HEIGHT,
+        .window_cost = PANEL_MASK_WINDOW_COST,
+        .flush_done = &dma_transfer_complete};
+    black_span_init(&span_info);
+    black_span_calibrate();
+    printf("Black span: set_window %u ns, flush overhead %u ns, %u ps/byte -> a burst costs %u bytes\n",
+           span_info.window_ns, span_info.burst_ns, span_info.byte_ps, span_info.window_cost);
+#endif
+#if PANEL_MASK
+    static panel_mask_info_t mask_info = {
+        .width = DISPLAY_WIDTH,
+        .height = DISPLAY_HEIGHT,
+        .window_cost = PANEL_MASK_WINDOW_COST};
+#if BLACK_SPAN
+    mask_info.window_cost = span_info.window_cost;
+#endif
+    panel_mask_init(&mask_info);
+    printf("Panel mask: %u bands, %lu of %d pixels sent per frame (%lu visible)\n", mask_info.band_count,
+           (unsigned long)mask_info.sent_pixels, DISPLAY_WIDTH * DISPLAY_HEIGHT, (unsigned long)mask_info.visible_pixels);
+#endif
+
     // --- SD CARD CODE --- (Removing test.txt logic)
     printf("Attempting to initialize SD card and mount filesystem...\n");
     if (!sd_init_driver())
@@ -81,7 +450,7 @@ int main()
         }
     }
     printf("SD card driver initialized successfully.\n");
-    FATFS fs;
+    static FATFS fs; // ~2.6 KB with the FAT cache: too big for main's stack
     FRESULT fr;
     fr = f_mount(&fs, "", 1);
     if (fr != FR_OK)
@@ -93,21 +462,91 @@ int main()
         }
     }
     printf("SD card mounted successfully.\n");
+    uint32_t mount_done_us = time_us_32();
     // --- END OF SD CARD CODE ---
 
-    printf("Setting up for animation with %d frames...\n", TOTAL_ANIMATION_FRAMES);
+    // Every clip in the manifest plays back to back; frame numbers run across the whole playlist
+    playlist_info_t playlist_info = {
+        .dir = PLAYLIST_DIR,
+        .default_duration_ms = FRAME_DEFAULT_DURATION_MS};
+    playlist_init(&playlist_info);
 
-    int num_frames = TOTAL_ANIMATION_FRAMES; // Use the defined total
+    static uint8_t frame_pool[FRAME_POOL_SIZE] __attribute__((aligned(4)));
+    size_t cache_pool_size = FRAME_POOL_SIZE; // Less the dirty-rect buffer at its end
+    size_t dirty_pool_bytes = 0;
+    bool stream_mode = false;
+    bool viewport_mode = false;
+#if FRAME_VIEWPORT
+    static frame_viewport_info_t viewport_info = {
+        .src_width = VIEWPORT_SOURCE_WIDTH,
+        .src_height = VIEWPORT_SOURCE_HEIGHT,
+        .out_x = 0,
+        .out_y = 0,
+        .out_width = DISPLAY_WIDTH,
+        .out_height = DISPLAY_HEIGHT,
+        .chunk_sectors = FRAME_STREAM_CHUNK_SECTORS,
+        .pool = frame_pool,
+        .pool_size = FRAME_POOL_SIZE,
+        .mask = PANEL_MASK,
+        .flush_done = &dma_transfer_complete};
+    if (playlist_info.frame_count > 0 && playlist_frame_bytes() == VIEWPORT_SOURCE_BYTES)
+    {
+        viewport_mode = frame_viewport_init(&viewport_info);
+        stream_mode = viewport_mode;
+        if (viewport_mode)
+        {
+            frame_viewport_set(0, 0, FRAME_VIEWPORT_ZOOM_Q8);
+            printf("Viewport: %ux%u of a %dx%d source, zoom %.2fx\n", viewport_info.view_width, viewport_info.view_height,
+                   VIEWPORT_SOURCE_WIDTH, VIEWPORT_SOURCE_HEIGHT, viewport_info.zoom_q8 / 256.0f);
+        }
+    }
+#endif
+#if FRAME_STREAM
+    static frame_stream_info_t stream_info = {
+        .x = 0,
+        .y = 0,
+        .width = DISPLAY_WIDTH,
+        .height = DISPLAY_HEIGHT,
+        .chunk_sectors = FRAME_STREAM_CHUNK_SECTORS,
+        .buffers = FRAME_STREAM_BUFFERS,
+        .pool = frame_pool,
+        .pool_size = FRAME_POOL_SIZE,
+        .mask = PANEL_MASK,
+        .flush_done = &dma_transfer_complete};
+    if (!viewport_mode && playlist_info.frame_count > 0 && playlist_frame_bytes() == STREAM_FRAME_BYTES)
+    {
+        stream_mode = frame_stream_init(&stream_info);
+        if (stream_mode)
+        {
+            printf("Full-resolution clip: streaming %dx%d frames through %u %u-byte chunks (%u bytes of the frame pool)\n",
+                   DISPLAY_WIDTH, DISPLAY_HEIGHT, stream_info.buffers, FRAME_STREAM_CHUNK_SECTORS * FRAME_STREAM_SECTOR,
+                   stream_info.buffers * FRAME_STREAM_CHUNK_SECTORS * FRAME_STREAM_SECTOR);
+        }
+    }
+#endif
 
-    if (num_frames == 0) // This condition might need adjustment if TOTAL_ANIMATION_FRAMES can be 0
+#if FRAME_PACK
+    static frame_pack_info_t pack_info = {
+        .path = FRAME_PACK_PATH,
+        .frame_bytes = FRAME_BYTES};
+    pack_info.frame_bytes = viewport_mode ? VIEWPORT_SOURCE_BYTES : stream_mode ? STREAM_FRAME_BYTES : FRAME_BYTES;
+    if (playlist_info.frame_count > 0)
     {
-        printf("ERROR: TOTAL_ANIMATION_FRAMES is 0. Halting with error colors.\n");
+        frame_pack_init(&pack_info);
+    }
+#endif
+
+    int num_frames = playlist_info.frame_count;
+    printf("Setting up for animation with %d frames...\n", num_frames);
+
+    if (num_frames == 0)
+    {
+        printf("ERROR: No frames in %smanifest.txt. Halting with error colors.\n", PLAYLIST_DIR);
         uint8_t error_colors[] = {RED_COLOR, BLUE_COLOR, GREEN_COLOR}; // Using new defines
         int error_color_index = 0;
         while (1)
         {
-            bsp_co5300_set_window(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1); // Full screen for error
-            uint8_t error_line_buffer[DISPLAY_WIDTH];                           // For 8-bit
+            uint8_t error_line_buffer[DISPLAY_WIDTH]; // For 8-bit
             for (int i = 0; i < DISPLAY_WIDTH; i++)
             {
                 error_line_buffer[i] = error_colors[error_color_index];
@@ -118,41 +557,104 @@ int main()
                 {
                     sleep_us(10);
                 }
-                dma_transfer_complete = false;
-                bsp_co5300_flush(error_line_buffer, DISPLAY_WIDTH); // For 8-bit
+                present_row(y, error_line_buffer); // Full screen for error
             }
             error_color_index = (error_color_index + 1) % 3;
             sleep_ms(333);
         }
     }
 
-    // Calculate padding for centering the frame
-    const int PADDING_X = (DISPLAY_WIDTH - SCALED_FRAME_WIDTH) / 2;   // Centering the central scaled tile
-    const int PADDING_Y = (DISPLAY_HEIGHT - SCALED_FRAME_HEIGHT) / 2; // Centering the central scaled tile
-
-    // Pre-calculate grid boundaries
-    const int GRID_LEFT = PADDING_X;
-    const int GRID_RIGHT = PADDING_X + SCALED_FRAME_WIDTH;
-    const int GRID_TOP = PADDING_Y;
-    const int GRID_BOTTOM = PADDING_Y + SCALED_FRAME_HEIGHT;
-    const int GRID_WIDTH = GRID_RIGHT - GRID_LEFT;
-    const int GRID_HEIGHT = GRID_BOTTOM - GRID_TOP;
+    // Tile grid boundaries, centred on the display
+    const int GRID_WIDTH = TILE_COLS * SCALED_FRAME_WIDTH + (TILE_COLS - 1) * TILE_GAP;
+    const int GRID_HEIGHT = TILE_ROWS * SCALED_FRAME_HEIGHT + (TILE_ROWS - 1) * TILE_GAP;
+    const int GRID_LEFT = (DISPLAY_WIDTH - GRID_WIDTH) / 2;
+    const int GRID_TOP = (DISPLAY_HEIGHT - GRID_HEIGHT) / 2;
+    const int GRID_BOTTOM = GRID_TOP + GRID_HEIGHT;
+    // A single tile at an integer scale is composed at source resolution and scaled on its way out:
+    // every source row fills GRID_ROW_REPEAT grid rows, every source column GRID_COL_REPEAT grid columns.
+    // Any other grid (the default 3x3 included) has both at 1: no DMA row replication, no PIO repeater
+    const bool GRID_SINGLE_TILE = TILE_COLS * TILE_ROWS == 1;
+    const int GRID_ROW_REPEAT = GRID_SINGLE_TILE && GRID_HEIGHT % FRAME_HEIGHT == 0 ? GRID_HEIGHT / FRAME_HEIGHT : 1;
+    const int GRID_COL_REPEAT = GRID_SINGLE_TILE && PIXEL_REPEAT_PIO && GRID_WIDTH % FRAME_WIDTH == 0 ? GRID_WIDTH / FRAME_WIDTH : 1;
 
-    // Create lookup tables for the grid area only
-    static uint8_t source_x_lut[SCALED_FRAME_WIDTH];  // Just 1 tile wide now
-    static uint8_t source_y_lut[SCALED_FRAME_HEIGHT]; // Just 1 tile tall now
-
-    // Pre-compute X lookup table (for 1 tile horizontally)
-    for (int x = 0; x < GRID_WIDTH; x++)
+    // The compositor works on the grid divided by the repeats
+    static tile_layout_info_t layout_info = {
+        .src_width = FRAME_WIDTH,
+        .src_height = FRAME_HEIGHT,
+        .cols = TILE_COLS,
+        .rows = TILE_ROWS,
+        .gap = TILE_GAP,
+        .get_row = frame_cache_get_row};
+    layout_info.tile_width = SCALED_FRAME_WIDTH / GRID_COL_REPEAT;
+    layout_info.tile_height = SCALED_FRAME_HEIGHT / GRID_ROW_REPEAT;
+    for (int i = 0; i < TILE_COLS * TILE_ROWS; i++)
+    {
+        layout_info.tiles[i].frame_phase = i * TILE_PHASE_STEP;
+        layout_info.tiles[i].mirror_x = TILE_MIRROR && (i % TILE_COLS) % 2 == 1;
+        layout_info.tiles[i].mirror_y = TILE_MIRROR && (i / TILE_COLS) % 2 == 1;
+    }
+    if (!stream_mode && !tile_layout_init(&layout_info))
     {
-        source_x_lut[x] = (x * FRAME_WIDTH) / SCALED_FRAME_WIDTH;
+        printf("ERROR: Tile layout doesn't fit. Halting.\n");
+        while (true)
+        {
+            tight_loop_contents();
+        }
     }
 
-    // Pre-compute Y lookup table (for 1 tile vertically)
-    for (int y = 0; y < GRID_HEIGHT; y++)
+#if SCANLINE_FX
+    static scanline_fx_info_t fx_info = {
+        .enabled = {
+            [SCANLINE_FX_GLITCH] = MAX_TARGET_GLITCH_PROBABILITY > 0,
+            [SCANLINE_FX_PALETTE] = SCANLINE_FX_PALETTE_STEP != 0,
+            [SCANLINE_FX_FADE] = SCANLINE_FX_FADE_LEVEL < 8,
+            [SCANLINE_FX_DARKEN] = SCANLINE_FX_DARKEN_ROWS},
+        .glitch_max_length = MAX_GLITCH_LENGTH,
+        .glitch_max_offset = MAX_GLITCH_OFFSET,
+        .glitch_max_rows = MAX_GLITCH_BLOCK_HEIGHT_LINES,
+        .palette_step = SCANLINE_FX_PALETTE_STEP,
+        .fade_level = SCANLINE_FX_FADE_LEVEL};
+    fx_info.width = layout_info.width;
+    fx_info.height = layout_info.height;
+    scanline_fx_init(&fx_info);
+#endif
+
+#if DIRTY_RECT
+    static dirty_rect_info_t dirty_info = {
+        .window_cost = PANEL_MASK_WINDOW_COST,
+        .max_rects = DIRTY_RECT_MAX_RECTS,
+        .flush_done = &dma_transfer_complete};
+    dirty_info.width = layout_info.width;   // One composed byte per unique grid column
+    dirty_info.height = layout_info.height; // One composed row per unique grid row
+    dirty_info.row_repeat = GRID_ROW_REPEAT;
+    dirty_info.col_repeat = GRID_COL_REPEAT;
+    dirty_info.mask = PANEL_MASK;
+#if BLACK_SPAN
+    dirty_info.window_cost = span_info.window_cost;
+    dirty_info.row_sent = black_span_mark; // Rects bypass present_row: keep its record of black blocks current
+#endif
+    bool dirty_mode = false;
+    if (!stream_mode)
     {
-        source_y_lut[y] = (y * FRAME_HEIGHT) / SCALED_FRAME_HEIGHT;
+        size_t bytes = dirty_rect_pool_bytes(&dirty_info);
+        if (bytes + DIRTY_RECT_MIN_CACHE_SLOTS * FRAME_BYTES <= FRAME_POOL_SIZE)
+        {
+            dirty_info.pool = &frame_pool[FRAME_POOL_SIZE - bytes];
+            dirty_info.pool_size = bytes;
+            dirty_mode = dirty_rect_init(&dirty_info);
+        }
+        else
+        {
+            printf("Dirty rect: a %u-byte buffer would leave the cache fewer than %d frames, sending line by line\n",
+                   (unsigned)bytes, DIRTY_RECT_MIN_CACHE_SLOTS);
+        }
+        if (dirty_mode)
+        {
+            dirty_pool_bytes = bytes;
+            cache_pool_size -= bytes;
+        }
     }
+#endif
 
     // Pre-create a black line for fast memcpy
     static uint8_t black_line[DISPLAY_WIDTH];
@@ -161,164 +663,387 @@ int main()
     // Main animation loop
     int current_frame_index = 0;
 
-    // Line buffer for sending to display
+    // Line buffer for sending to display; only the grid columns are ever written, the rest stays black
     static uint8_t line_buffer[DISPLAY_WIDTH]; // Just one line
+    static uint8_t grid_line[TILE_LAYOUT_MAX_SIZE]; // A composed grid row before the horizontal repeat
+
+    // Frame cache - compressed whole-clip if it fits, otherwise raw slots: FRAMES_TO_BUFFER, or as many as
+    // fit beside the dirty-rect buffer
+    int raw_slots = cache_pool_size / FRAME_BYTES < FRAMES_TO_BUFFER ? cache_pool_size / FRAME_BYTES : FRAMES_TO_BUFFER;
+    frame_cache_info_t cache_info = {
+        .mode = FRAME_CACHE_MODE_RAW,
+        .frame_width = FRAME_WIDTH,
+        .frame_height = FRAME_HEIGHT,
+        .pool = frame_pool,
+        .pool_size = raw_slots * FRAME_BYTES};
+    bool clip_resident = false;
 
-    // Multi-frame buffer system - simplified!
-    static uint8_t frame_buffers[FRAMES_TO_BUFFER][FRAME_HEIGHT * FRAME_WIDTH];
-    static int frame_indices[FRAMES_TO_BUFFER]; // Which frame number is in each buffer slot
+    uint32_t cache_fill_start_us = time_us_32();
 
-    // Initialize all slots as empty
-    for (int i = 0; i < FRAMES_TO_BUFFER; i++)
+#if PSRAM_FRAME_STORE
+    if (!stream_mode && bsp_psram_init() > 0)
     {
-        frame_indices[i] = -1;
+        uint8_t *psram_pool = bsp_psram_alloc(num_frames * FRAME_BYTES);
+        if (psram_pool != NULL)
+        {
+            cache_info.mode = FRAME_CACHE_MODE_RAW;
+            cache_info.pool = psram_pool;
+            cache_info.pool_size = num_frames * FRAME_BYTES;
+            cache_info.external_pool = true;
+            frame_cache_init(&cache_info);
+
+            printf("Loading %d raw frames into PSRAM (%u KB available)...\n", num_frames, bsp_psram_get_size() / 1024);
+            uint32_t load_start_us = time_us_32();
+            clip_resident = load_whole_clip(num_frames);
+            if (clip_resident)
+            {
+                printf("Clip resident in PSRAM: %d frames in %u ms\n", num_frames, (time_us_32() - load_start_us) / 1000);
+            }
+        }
     }
+#endif
 
-    FIL frame_fil;
-    UINT bytes_read_for_full_frame;
-    char current_frame_full_path[MAX_FILENAME_LEN + 8];
+#if FRAME_CACHE_COMPRESSED
+    if (!clip_resident && !stream_mode)
+    {
+        cache_info.mode = FRAME_CACHE_MODE_COMPRESSED;
+        cache_info.pool = frame_pool;
+        cache_info.pool_size = cache_pool_size;
+        cache_info.external_pool = false;
+        frame_cache_init(&cache_info);
 
-    // Pre-load initial frames
-    printf("Pre-loading %d frames into RAM...\n", FRAMES_TO_BUFFER);
-    for (int i = 0; i < FRAMES_TO_BUFFER && i < num_frames; i++)
+        printf("Loading %d frames compressed into RAM...\n", num_frames);
+        uint32_t load_start_us = time_us_32();
+        clip_resident = load_whole_clip(num_frames);
+        if (clip_resident)
+        {
+            printf("Clip resident: %u frames, %u -> %u bytes (ratio %.2f:1) in %u ms\n",
+                   cache_info.frames_stored, cache_info.raw_bytes, cache_info.stored_bytes,
+                   (float)cache_info.raw_bytes / cache_info.stored_bytes,
+                   (time_us_32() - load_start_us) / 1000);
+        }
+    }
+#endif
+
+    if (!clip_resident && !stream_mode)
     {
-        snprintf(current_frame_full_path, sizeof(current_frame_full_path), "/output/snowman-%d.bin", i);
-        fr = f_open(&frame_fil, current_frame_full_path, FA_READ);
+        cache_info.mode = FRAME_CACHE_MODE_RAW;
+        cache_info.pool = frame_pool;
+        cache_info.pool_size = raw_slots * FRAME_BYTES;
+        cache_info.external_pool = false;
 
-        if (fr == FR_OK)
+        frame_cache_init(&cache_info);
+
+        // Pre-load initial frames
+        printf("Pre-loading %d frames into RAM...\n", raw_slots);
+        for (int i = 0; i < raw_slots && i < num_frames; i++)
         {
-            fr = f_read(&frame_fil, frame_buffers[i], FRAME_HEIGHT * FRAME_WIDTH, &bytes_read_for_full_frame);
-            if (fr == FR_OK && bytes_read_for_full_frame == FRAME_HEIGHT * FRAME_WIDTH)
+            if (load_frame(i))
             {
-                frame_indices[i] = i;
-                printf("Pre-loaded frame %d into slot %d\n", i, i);
+                printf("Pre-loaded frame %d\n", i);
             }
-            else
-            {
-                memset(frame_buffers[i], 0x00, FRAME_HEIGHT * FRAME_WIDTH);
-            }
-            f_close(&frame_fil);
-        }
-        else
-        {
-            memset(frame_buffers[i], 0x00, FRAME_HEIGHT * FRAME_WIDTH);
         }
     }
 
+    uint32_t cache_fill_us = time_us_32() - cache_fill_start_us;
+    bool use_prefetch = !clip_resident && !stream_mode; // Streamed frames are read as they are sent
+
+    // Look-ahead grows with the card's p99 load latency, within the slots not on screen
+    prefetch_info_t prefetch_info = {
+        .min_depth = 1,
+        .max_depth = raw_slots - 1,
+        .load = load_frame};
+    prefetch_init(&prefetch_info);
+
+#if PSRAM_FRAME_STORE && PSRAM_BENCH
+    if (clip_resident && cache_info.external_pool)
+    {
+        run_psram_bench(num_frames, frame_pool);
+    }
+#endif
+
+    const uint16_t *frame_durations_ms = playlist_durations_ms();
+
+#if CLIP_TRANSITION
+    static clip_transition_info_t transition_info = {
+        .frames = CLIP_TRANSITION_FRAMES,
+        .width = FRAME_WIDTH,
+        .bench_lead = CLIP_TRANSITION_BENCH ? CLIP_TRANSITION_BENCH_LEAD : 0,
+        .get_row = frame_cache_get_row};
+    // With raw slots the look-ahead must reach from the tail frame to its incoming frame and one past it
+    if (use_prefetch && transition_info.frames > raw_slots - 2)
+    {
+        transition_info.frames = raw_slots - 2;
+    }
+    if (stream_mode)
+    {
+        transition_info.frames = 0; // Streamed frames are never both in memory
+    }
+    bool transition_mode = clip_transition_init(&transition_info);
+    if (transition_mode)
+    {
+        layout_info.get_row = clip_transition_get_row;
+        printf("Clip transitions: up to %u-frame crossfades between %u clips\n", transition_info.frames, playlist_info.clip_count);
+    }
+#endif
+
+    frame_scheduler_info_t scheduler_info = {
+        .policy = FRAME_PACING_POLICY,
+        .late_threshold_us = FRAME_LATE_THRESHOLD_US};
+    frame_scheduler_init(&scheduler_info);
+
+    // Everything is allocated by now: what the heap has left is measured, not estimated
+    printf("RAM: %u-byte frame pool (%s%u bytes for the cache, %u for the dirty-rect buffer), %u bytes of heap free\n",
+           FRAME_POOL_SIZE, stream_mode ? "streaming, " : "", stream_mode ? 0u : (unsigned)cache_pool_size,
+           (unsigned)dirty_pool_bytes, (unsigned)heap_free_bytes());
     printf("Starting animation loop with %d frames.\n", num_frames);
 
     int frames_displayed = 0;
+#if PLAYLIST_VERBOSE
+    int current_clip = -1;
+#endif
     uint32_t start_time = to_ms_since_boot(get_absolute_time());
 
     while (1)
     {
-        // Find which buffer slot has our current frame
-        int buffer_slot = -1;
-        for (int i = 0; i < FRAMES_TO_BUFFER; i++)
+        // The look-ahead window runs across clip boundaries, so the next clip's first
+        // frames are already loaded during the current clip's tail
+#if PLAYLIST_VERBOSE
+        if (playlist_clip_of(current_frame_index) != current_clip)
         {
-            if (frame_indices[i] == current_frame_index)
+            current_clip = playlist_clip_of(current_frame_index);
+            printf("Playing clip %d: %s\n", current_clip, playlist_clip_name(current_clip));
+        }
+#endif
+
+        uint32_t duration_us = frame_durations_ms[current_frame_index] * 1000;
+        uint32_t frame_start_us = time_us_32();
+        uint32_t stage_start_us = frame_start_us;
+
+        // If not cached the prefetcher fell behind: log the underrun and load it immediately,
+        // unless the frame is going to be dropped anyway
+        if (use_prefetch && !frame_cache_contains(current_frame_index) &&
+            !frame_scheduler_deadline_passed(duration_us))
+        {
+            prefetch_underrun(current_frame_index);
+            frame_scheduler_stage_time(FRAME_STAGE_SD, time_us_32() - stage_start_us);
+        }
+#if CLIP_TRANSITION
+        // A crossfade frame needs the incoming clip's frame as well
+        int incoming_frame_index = clip_transition_incoming(current_frame_index, NULL);
+        if (use_prefetch && incoming_frame_index >= 0 && !frame_cache_contains(incoming_frame_index) &&
+            !frame_scheduler_deadline_passed(duration_us))
+        {
+            stage_start_us = time_us_32();
+            prefetch_underrun(incoming_frame_index);
+            frame_scheduler_stage_time(FRAME_STAGE_SD, time_us_32() - stage_start_us);
+        }
+        uint32_t load_us = time_us_32() - frame_start_us; // Counts toward the frame's deadline
+#endif
+
+        // Wait for this frame's presentation time. A dropped frame is neither composed nor
+        // sent, but still advances the prefetch window past every frame that is already stale
+        if (!frame_scheduler_wait(duration_us))
+        {
+            if (use_prefetch)
             {
-                buffer_slot = i;
-                break;
+                stage_start_us = time_us_32();
+                prefetch_cancel(current_frame_index);
+                run_prefetch(current_frame_index, num_frames, frame_durations_ms);
+                frame_scheduler_stage_time(FRAME_STAGE_SD, time_us_32() - stage_start_us);
             }
+#if CLIP_TRANSITION
+            clip_transition_drop_frame(current_frame_index);
+#endif
+            current_frame_index = next_frame_of(current_frame_index, num_frames);
+            continue;
         }
 
-        // If not found, load it immediately (shouldn't happen after initial load)
-        if (buffer_slot == -1)
+        uint32_t present_start_us = time_us_32();
+        stage_start_us = present_start_us;
+#if SCANLINE_FX
+        if (!stream_mode)
+        {
+            // Glitches come and go: the chance per row follows a slow cosine
+            float t = to_ms_since_boot(get_absolute_time()) / 1000.0f;
+            float probability = MAX_TARGET_GLITCH_PROBABILITY * 0.5f *
+                                (1.0f - cosf(2.0f * (float)M_PI * t / GLITCH_PROBABILITY_PERIOD_SECONDS));
+            fx_info.glitch_chance = (uint16_t)(probability * 65535.0f);
+            scanline_fx_begin_frame(duration_us ? duration_us : SCANLINE_FX_BUDGET_US);
+        }
+#endif
+#if FRAME_STREAM
+        if (stream_mode)
         {
-            buffer_slot = current_frame_index % FRAMES_TO_BUFFER;
-            snprintf(current_frame_full_path, sizeof(current_frame_full_path), "/gif-converter/output/snowman-%d.bin", current_frame_index);
-            fr = f_open(&frame_fil, current_frame_full_path, FA_READ);
-            if (fr == FR_OK)
+            // Card reads overlap the display DMA; only the time blocked on the card is SD time
+            uint32_t read_us;
+#if FRAME_VIEWPORT
+            if (viewport_mode)
             {
-                f_read(&frame_fil, frame_buffers[buffer_slot], FRAME_HEIGHT * FRAME_WIDTH, &bytes_read_for_full_frame);
-                f_close(&frame_fil);
+                // Sweep the viewport back and forth along the source diagonal
+                int phase = frames_displayed % (2 * FRAME_VIEWPORT_PAN_FRAMES);
+                if (phase > FRAME_VIEWPORT_PAN_FRAMES)
+                {
+                    phase = 2 * FRAME_VIEWPORT_PAN_FRAMES - phase;
+                }
+                frame_viewport_set((VIEWPORT_SOURCE_WIDTH - viewport_info.view_width) * phase / FRAME_VIEWPORT_PAN_FRAMES,
+                                   (VIEWPORT_SOURCE_HEIGHT - viewport_info.view_height) * phase / FRAME_VIEWPORT_PAN_FRAMES,
+                                   FRAME_VIEWPORT_ZOOM_Q8);
+
+                uint32_t read_start_us = viewport_info.read_us;
+                frame_viewport_present(current_frame_index);
+                read_us = viewport_info.read_us - read_start_us;
             }
             else
+#endif
             {
-                memset(frame_buffers[buffer_slot], 0x00, FRAME_HEIGHT * FRAME_WIDTH);
+                uint32_t read_start_us = stream_info.read_us;
+                frame_stream_present(current_frame_index);
+                read_us = stream_info.read_us - read_start_us;
             }
-            frame_indices[buffer_slot] = current_frame_index;
+            frame_scheduler_stage_time(FRAME_STAGE_SD, read_us);
+            frame_scheduler_stage_time(FRAME_STAGE_COMPOSE, time_us_32() - stage_start_us - read_us);
         }
-
-        // Use the buffered frame
-        uint8_t *full_source_frame_buffer = frame_buffers[buffer_slot];
-
-        // Send the frame line by line, building each line on the fly
-        bsp_co5300_set_window(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
-
-        for (int y = 0; y < DISPLAY_HEIGHT; y++)
+        else
+#endif
+#if DIRTY_RECT
+        if (dirty_mode && frames_displayed > 0)
+        {
+            // The borders are already black from the first frame: compose just the grid, each
+            // unique row once (the DMA chain repeats it GRID_ROW_REPEAT times) and each unique
+            // column once (the PIO repeats it GRID_COL_REPEAT times)
+            for (int row = 0; row < dirty_info.height; row++)
+            {
+                uint8_t *grid_row = dirty_rect_line();
+                tile_layout_compose_row(row, current_frame_index, num_frames, grid_row);
+#if SCANLINE_FX
+                scanline_fx_apply_row(row, grid_row);
+#endif
+                dirty_rect_commit_row(row);
+            }
+            // Returns with the last chain running; the CPU is free until the next frame's rects
+            dirty_rect_present(GRID_LEFT, GRID_TOP);
+            frame_scheduler_stage_time(FRAME_STAGE_COMPOSE, time_us_32() - stage_start_us);
+        }
+        else
+#endif
         {
-            // Wait for any previous DMA to complete first
+            // Send the frame line by line, building each line on the fly
+#if DIRTY_RECT
+            // Full panel-resolution rows: the pixel repeater must be off
             while (!dma_transfer_complete)
             {
                 sleep_us(10);
             }
+            bsp_co5300_set_pixel_repeat(1);
+#endif
 
-            // Build one line
-            if (y < GRID_TOP || y >= GRID_BOTTOM)
+            for (int y = 0; y < DISPLAY_HEIGHT; y++)
             {
-                // Entire line is black - use pre-made black line
-                dma_transfer_complete = false;
-                bsp_co5300_flush(black_line, DISPLAY_WIDTH);
-            }
-            else
-            {
-                // Line has some content
-                int grid_y = y - GRID_TOP;
-                uint8_t source_y = source_y_lut[grid_y];
-                uint8_t *source_row = &full_source_frame_buffer[source_y * FRAME_WIDTH];
-
-                // Fill black on left
-                if (GRID_LEFT > 0)
+                // Wait for any previous DMA to complete first
+                while (!dma_transfer_complete)
                 {
-                    memset(line_buffer, 0x00, GRID_LEFT);
+                    sleep_us(10);
                 }
 
-                // Fill content in middle using lookup table
-                uint8_t *dest = &line_buffer[GRID_LEFT];
-                for (int grid_x = 0; grid_x < GRID_WIDTH; grid_x++)
+                // Build one line
+                if (y < GRID_TOP || y >= GRID_BOTTOM)
                 {
-                    *dest++ = source_row[source_x_lut[grid_x]];
+                    // Entire line is black - use pre-made black line
+                    present_row(y, black_line);
                 }
-
-                // Fill black on right
-                if (GRID_RIGHT < DISPLAY_WIDTH)
+                else
                 {
-                    memset(&line_buffer[GRID_RIGHT], 0x00, DISPLAY_WIDTH - GRID_RIGHT);
+                    // Line has some content
+                    int grid_y = y - GRID_TOP;
+                    // A repeated grid row (vertical scaling) reuses the line already built
+                    if (grid_y % GRID_ROW_REPEAT == 0)
+                    {
+                        int layout_y = grid_y / GRID_ROW_REPEAT;
+                        if (GRID_COL_REPEAT == 1)
+                        {
+                            tile_layout_compose_row(layout_y, current_frame_index, num_frames, &line_buffer[GRID_LEFT]);
+#if SCANLINE_FX
+                            scanline_fx_apply_row(layout_y, &line_buffer[GRID_LEFT]);
+#endif
+                        }
+                        else
+                        {
+                            // Widen the source-resolution row here, as the PIO does on the dirty path
+                            tile_layout_compose_row(layout_y, current_frame_index, num_frames, grid_line);
+#if SCANLINE_FX
+                            scanline_fx_apply_row(layout_y, grid_line);
+#endif
+                            uint8_t *dest = &line_buffer[GRID_LEFT];
+                            for (int x = 0; x < layout_info.width; x++)
+                            {
+                                memset(dest, grid_line[x], GRID_COL_REPEAT);
+                                dest += GRID_COL_REPEAT;
+                            }
+                        }
+                    }
+
+                    present_row(y, line_buffer);
                 }
+            }
 
-                dma_transfer_complete = false;
-                bsp_co5300_flush(line_buffer, DISPLAY_WIDTH);
+            // Wait for the last line's DMA to complete
+            while (!dma_transfer_complete)
+            {
+                sleep_us(10);
             }
+#if DIRTY_RECT
+            dirty_rect_invalidate(); // The tile went out line by line, not from the front buffer
+#endif
+
+            frame_scheduler_stage_time(FRAME_STAGE_COMPOSE, time_us_32() - stage_start_us);
         }
 
-        // Wait for the last line's DMA to complete
-        while (!dma_transfer_complete)
+#if SCANLINE_FX
+        if (!stream_mode)
         {
-            sleep_us(10);
+            scanline_fx_end_frame(time_us_32() - stage_start_us);
         }
+#endif
 
-        // Load the frame that will be needed FRAMES_TO_BUFFER frames from now
-        int future_frame = (current_frame_index + FRAMES_TO_BUFFER) % num_frames;
-        int slot_to_replace = future_frame % FRAMES_TO_BUFFER;
+        // Top up the look-ahead window behind the frame just shown
+        if (use_prefetch)
+        {
+            stage_start_us = time_us_32();
+            run_prefetch(current_frame_index, num_frames, frame_durations_ms);
+            frame_scheduler_stage_time(FRAME_STAGE_SD, time_us_32() - stage_start_us);
+        }
 
-        // Only load if this slot doesn't already have the frame we need
-        if (frame_indices[slot_to_replace] != future_frame)
+#if FRAME_STREAM
+        // Read the next frame's head while this frame's last chunk is still on the wire
+        if (stream_mode && !viewport_mode)
         {
-            snprintf(current_frame_full_path, sizeof(current_frame_full_path), "/gif-converter/output/snowman-%d.bin", future_frame);
-            fr = f_open(&frame_fil, current_frame_full_path, FA_READ);
-            if (fr == FR_OK)
-            {
-                f_read(&frame_fil, frame_buffers[slot_to_replace], FRAME_HEIGHT * FRAME_WIDTH, &bytes_read_for_full_frame);
-                f_close(&frame_fil);
-                frame_indices[slot_to_replace] = future_frame;
-            }
+            stage_start_us = time_us_32();
+            frame_stream_preload((current_frame_index + 1) % num_frames);
+            frame_scheduler_stage_time(FRAME_STAGE_SD, time_us_32() - stage_start_us);
         }
+#endif
 
-        current_frame_index = (current_frame_index + 1) % num_frames;
+#if CLIP_TRANSITION
+        // The frame's work, loads included, against the time it has on screen
+        clip_transition_end_frame(current_frame_index, load_us + time_us_32() - present_start_us,
+                                  duration_us ? duration_us : CLIP_TRANSITION_BUDGET_US);
+#if CLIP_TRANSITION_BENCH
+        print_transition_reports();
+#endif
+#endif
+
+        current_frame_index = next_frame_of(current_frame_index, num_frames);
         frames_displayed++;
 
+        if (frames_displayed == 1)
+        {
+            printf("Startup: first frame after %u ms (display+mount %u ms, playlist %u us from %s, cache fill %u ms)\n",
+                   (time_us_32() - startup_start_us) / 1000, (mount_done_us - startup_start_us) / 1000,
+                   playlist_info.load_us, playlist_info.from_index ? "index.bin" : "manifest.txt",
+                   cache_fill_us / 1000);
+        }
+
         // Print FPS every 100 frames
         if (frames_displayed % 100 == 0)
         {
@@ -326,6 +1051,127 @@ int main()
             uint32_t elapsed_ms = current_time - start_time;
             float fps = (frames_displayed * 1000.0f) / elapsed_ms;
             printf("FPS: %.2f (displayed %d frames in %u ms)\n", fps, frames_displayed, elapsed_ms);
+            if (cache_info.mode == FRAME_CACHE_MODE_COMPRESSED)
+            {
+                printf("Decode: %u us/frame (%u rows/frame)\n",
+                       (uint32_t)(cache_info.decode_us / frames_displayed), cache_info.rows_decoded / frames_displayed);
+            }
+            uint32_t on_time = scheduler_info.frames_on_time;
+            printf("Pacing: %u late (max %u us), %u dropped, jitter avg %u us max %u us\n",
+                   scheduler_info.frames_late, scheduler_info.late_max_us, scheduler_info.frames_dropped,
+                   on_time ? scheduler_info.jitter_sum_us / on_time : 0, scheduler_info.jitter_max_us);
+            printf("  overruns: SD %u late / %u dropped, compose %u late / %u dropped\n",
+                   scheduler_info.late_by_stage[FRAME_STAGE_SD], scheduler_info.dropped_by_stage[FRAME_STAGE_SD],
+                   scheduler_info.late_by_stage[FRAME_STAGE_COMPOSE], scheduler_info.dropped_by_stage[FRAME_STAGE_COMPOSE]);
+            frame_scheduler_reset_stats();
+
+#if BLACK_SPAN
+            if (span_info.rows > 0)
+            {
+                uint32_t row_bytes = span_info.bytes_sent + span_info.bytes_skipped;
+                printf("Black span: %u%% of row bytes skipped, %u rows skipped, %u extra bursts, %u us scanning\n",
+                       row_bytes ? (uint32_t)((uint64_t)span_info.bytes_skipped * 100 / row_bytes) : 0,
+                       span_info.rows_skipped, span_info.bursts, span_info.scan_us);
+                black_span_reset_stats();
+            }
+#endif
+            if (!stream_mode && layout_info.rows_composed > 0)
+            {
+                printf("Layout: %ux%u tiles, %u us per composed frame, %u spans scaled, %u reused\n",
+                       TILE_COLS, TILE_ROWS, (uint32_t)((uint64_t)layout_info.compose_us * layout_info.height / layout_info.rows_composed),
+                       layout_info.spans_scaled, layout_info.spans_reused);
+                tile_layout_reset_stats();
+            }
+#if SCANLINE_FX
+            if (!stream_mode && fx_info.frames > 0)
+            {
+                static const char level_marks[] = {'-', 'd', 'F'}; // Off, degraded, full
+                printf("Effects: glitch %c palette %c fade %c darken %c, %u us/frame, %u over budget, %u shed, %u restored\n",
+                       level_marks[fx_info.level[SCANLINE_FX_GLITCH]], level_marks[fx_info.level[SCANLINE_FX_PALETTE]],
+                       level_marks[fx_info.level[SCANLINE_FX_FADE]], level_marks[fx_info.level[SCANLINE_FX_DARKEN]],
+                       fx_info.fx_us / fx_info.frames, fx_info.over_budget, fx_info.shed, fx_info.restored);
+                scanline_fx_reset_stats();
+            }
+#endif
+#if CLIP_TRANSITION
+            if (transition_mode)
+            {
+                print_transition_reports();
+                if (transition_info.rows_blended + transition_info.rows_unblended > 0)
+                {
+                    printf("Transitions: %u finished, %u frames over deadline, %u rows blended in %u us, %u without the incoming frame\n",
+                           transition_info.transitions, transition_info.frames_over_deadline, transition_info.rows_blended,
+                           transition_info.blend_us, transition_info.rows_unblended);
+                    clip_transition_reset_stats();
+                }
+            }
+#endif
+#if DIRTY_RECT
+            if (dirty_mode && dirty_info.frames > 0)
+            {
+                printf("Dirty rect: %u rects, %u full, %u unchanged of %u frames, %u%% of tile bytes sent, %u us diffing\n",
+                       dirty_info.rects, dirty_info.full_frames, dirty_info.clean_frames, dirty_info.frames,
+                       (uint32_t)((uint64_t)dirty_info.bytes_sent * 100 / ((uint64_t)dirty_info.frames * GRID_WIDTH * GRID_HEIGHT)),
+                       dirty_info.diff_us);
+                dirty_rect_reset_stats();
+            }
+#endif
+#if FRAME_VIEWPORT
+            if (viewport_mode)
+            {
+                uint32_t full_sectors = (VIEWPORT_SOURCE_BYTES + 511) / 512;
+                printf("Viewport: %u sectors/frame in %u reads (%u%% of a full frame), %u us/frame reading SD, %u failed\n",
+                       viewport_info.sectors_read / viewport_info.frames, viewport_info.reads / viewport_info.frames,
+                       viewport_info.sectors_read * 100 / (viewport_info.frames * full_sectors),
+                       viewport_info.read_us / viewport_info.frames, viewport_info.failures);
+                frame_viewport_reset_stats();
+            }
+#endif
+#if FRAME_STREAM
+            if (stream_mode && !viewport_mode)
+            {
+                // Whichever bus is busier per frame bounds the frame rate; stream_us is what it took
+                uint32_t sd_us = stream_info.read_us / stream_info.frames;
+                uint32_t bus_us = stream_info.display_us / stream_info.frames;
+                uint32_t stream_us = stream_info.stream_us / stream_info.frames;
+                printf("Stream: SD %u us/frame, display bus %u us/frame -> %s-bound (est. max %.1f FPS), "
+                       "measured %u us/frame (%.1f FPS); %u us/frame waiting on DMA, %u chunks read ahead, %u failed\n",
+                       sd_us, bus_us, sd_us > bus_us ? "SD" : "display",
+                       1000000.0f / (sd_us > bus_us ? sd_us : bus_us), stream_us, stream_us ? 1000000.0f / stream_us : 0.0f,
+                       stream_info.wait_us / stream_info.frames, stream_info.preloaded, stream_info.failures);
+                frame_stream_reset_stats();
+            }
+#endif
+
+            if (use_prefetch)
+            {
+                printf("Prefetch: depth %u/%u, p99 load %u us, period %u us, %u loads, %u failed, %u underruns, %u cancelled\n",
+                       prefetch_info.depth, prefetch_info.max_depth, prefetch_info.p99_us, prefetch_info.frame_period_us,
+                       prefetch_info.loads, prefetch_info.load_failures, prefetch_info.underruns, prefetch_info.cancelled);
+
+                disk_cache_stats_t disk_stats;
+                if (disk_ioctl(0, DISK_CACHE_GET_STATS, &disk_stats) == RES_OK && disk_stats.reads > 0)
+                {
+                    uint32_t singles = disk_stats.lru_hits + disk_stats.read_ahead_hits + disk_stats.misses;
+                    printf("Disk cache: %u reads, %u%% single-sector hits (%u LRU, %u read-ahead), %u read-aheads, %u multi-sector\n",
+                           disk_stats.reads, singles ? (disk_stats.lru_hits + disk_stats.read_ahead_hits) * 100 / singles : 0,
+                           disk_stats.lru_hits, disk_stats.read_ahead_hits, disk_stats.read_aheads, disk_stats.passthrough);
+                }
+
+                DWORD fs_contended, fs_timeouts;
+                ff_mutex_stats(0, &fs_contended, &fs_timeouts);
+                if (fs_contended || fs_timeouts)
+                {
+                    printf("FatFS lock: %u contended, %u timed out\n", fs_contended, fs_timeouts);
+                }
+
+                prefetch_underrun_t underrun;
+                while (prefetch_pop_underrun(&underrun))
+                {
+                    printf("  underrun: frame %d at %u ms (depth %u, p99 %u us)\n",
+                           underrun.frame_index, underrun.time_ms, underrun.depth, underrun.p99_us);
+                }
+            }
         }
     }
 
@@ -0,0 +1,130 @@
+#include "panel_mask.h"
+
+panel_mask_info_t *g_panel_mask_info;
+
+static uint16_t s_chord_start[PANEL_MASK_MAX_ROWS];
+static uint16_t s_chord_end[PANEL_MASK_MAX_ROWS];
+static panel_mask_band_t s_bands[PANEL_MASK_MAX_ROWS];
+static uint16_t s_band_of_row[PANEL_MASK_MAX_ROWS];
+
+static uint32_t isqrt(uint32_t n)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > n)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (n >= root + bit)
+        {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Pixel (x, y) is visible when its centre lies in the inscribed disc. In
+// doubled coordinates that is (2x + 1 - W)^2 + (2y + 1 - H)^2 <= D^2.
+static void compute_chord(panel_mask_info_t *info, int y)
+{
+    int32_t diameter = info->width < info->height ? info->width : info->height;
+    int32_t dy = 2 * y + 1 - info->height;
+    int32_t left = diameter * diameter - dy * dy;
+    if (left < 0)
+    {
+        s_chord_start[y] = s_chord_end[y] = info->width / 2;
+        return;
+    }
+
+    // |2x + 1 - W| <= m
+    int32_t m = isqrt(left);
+    int32_t x_start = (info->width - m) / 2;     // ceil((W - m - 1) / 2)
+    int32_t x_last = (info->width + m - 1) / 2;  // floor((W + m - 1) / 2)
+    if (x_start < 0)
+        x_start = 0;
+    if (x_last > info->width - 1)
+        x_last = info->width - 1;
+    s_chord_start[y] = x_start;
+    s_chord_end[y] = x_last >= x_start ? x_last + 1 : x_start;
+}
+
+void panel_mask_init(panel_mask_info_t *mask_info)
+{
+    g_panel_mask_info = mask_info;
+    if (mask_info->height > PANEL_MASK_MAX_ROWS)
+        mask_info->height = PANEL_MASK_MAX_ROWS;
+
+    mask_info->visible_pixels = 0;
+    for (int y = 0; y < mask_info->height; y++)
+    {
+        compute_chord(mask_info, y);
+        mask_info->visible_pixels += s_chord_end[y] - s_chord_start[y];
+    }
+
+    // Greedy merge: widening a band to the union span wastes
+    // (rows * union width - sum of chords) pixels, one window less saves window_cost
+    int bands = 0;
+    uint32_t band_chords = 0;
+    mask_info->sent_pixels = 0;
+    for (int y = 0; y < mask_info->height; y++)
+    {
+        uint32_t chord = s_chord_end[y] - s_chord_start[y];
+        panel_mask_band_t *band;
+        if (bands > 0)
+        {
+            band = &s_bands[bands - 1];
+            uint16_t x_start = s_chord_start[y] < band->x_start ? s_chord_start[y] : band->x_start;
+            uint16_t x_end = s_chord_end[y] > band->x_end ? s_chord_end[y] : band->x_end;
+            uint32_t rows = band->y_end - band->y_start;
+            uint32_t waste_before = rows * (band->x_end - band->x_start) - band_chords;
+            uint32_t waste_after = (rows + 1) * (x_end - x_start) - band_chords - chord;
+            if (waste_after - waste_before <= mask_info->window_cost)
+            {
+                band->x_start = x_start;
+                band->x_end = x_end;
+                band->y_end = y + 1;
+                band_chords += chord;
+                s_band_of_row[y] = bands - 1;
+                continue;
+            }
+            mask_info->sent_pixels += rows * (band->x_end - band->x_start);
+        }
+
+        band = &s_bands[bands];
+        band->y_start = y;
+        band->y_end = y + 1;
+        band->x_start = s_chord_start[y];
+        band->x_end = s_chord_end[y] > s_chord_start[y] ? s_chord_end[y] : s_chord_start[y] + 1; // Windows can't be empty
+        band_chords = chord;
+        s_band_of_row[y] = bands;
+        bands++;
+    }
+    if (bands > 0)
+    {
+        panel_mask_band_t *band = &s_bands[bands - 1];
+        mask_info->sent_pixels += (band->y_end - band->y_start) * (band->x_end - band->x_start);
+    }
+    mask_info->band_count = bands;
+}
+
+panel_mask_info_t *panel_mask_get_info(void)
+{
+    return g_panel_mask_info;
+}
+
+void panel_mask_row_chord(int y, uint16_t *x_start, uint16_t *x_end)
+{
+    *x_start = s_chord_start[y];
+    *x_end = s_chord_end[y];
+}
+
+const panel_mask_band_t *panel_mask_band_of_row(int y)
+{
+    return &s_bands[s_band_of_row[y]];
+}
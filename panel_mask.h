@@ -0,0 +1,42 @@
+#ifndef __PANEL_MASK_H__
+#define __PANEL_MASK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PANEL_MASK_MAX_ROWS 480
+
+// Rows [y_start, y_end) are sent as columns [x_start, x_end) under one window
+typedef struct
+{
+    uint16_t y_start;
+    uint16_t y_end;
+    uint16_t x_start;
+    uint16_t x_end;
+} panel_mask_band_t;
+
+typedef struct
+{
+    uint16_t width;        // Panel size; the visible disc is inscribed in it
+    uint16_t height;
+    uint16_t window_cost;  // Cost of one extra set_window, in pixel bytes
+
+    // Computed by panel_mask_init()
+    uint16_t band_count;
+    uint32_t visible_pixels; // Inside the disc
+    uint32_t sent_pixels;    // Sent per full frame with the band table (visible plus merge waste)
+} panel_mask_info_t;
+
+// Builds the per-row chord table and merges rows into bands: the next row joins
+// the current band while the pixels that adds outside the disc cost less than
+// a window command.
+void panel_mask_init(panel_mask_info_t *mask_info);
+panel_mask_info_t *panel_mask_get_info(void);
+
+// Exact visible columns [x_start, x_end) of a row
+void panel_mask_row_chord(int y, uint16_t *x_start, uint16_t *x_end);
+
+// Band holding row y; its window is set when y == band->y_start
+const panel_mask_band_t *panel_mask_band_of_row(int y);
+
+#endif // __PANEL_MASK_H__
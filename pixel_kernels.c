@@ -0,0 +1,330 @@
+#include "pixel_kernels.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+
+static int s_fill_channel = -1;
+static bool s_fill_claimed; // A channel was asked for, free or not
+static uint32_t s_fill_word; // DMA source: the fill byte in every lane
+
+// The 4-pixel operations below never carry from one byte lane into the next,
+// so they also work on a single pixel in the low lane.
+
+// Each channel is moved to the bottom of its lane first: a weighted sum of two
+// channels is at most 7 * 32 + 16, which still fits the lane
+static inline uint32_t blend332x4(uint32_t a, uint32_t b, uint32_t wa, uint32_t wb)
+{
+    uint32_t r = ((((a >> 5) & 0x07070707) * wa + ((b >> 5) & 0x07070707) * wb + 0x10101010) >> 5) & 0x07070707;
+    uint32_t g = ((((a >> 2) & 0x07070707) * wa + ((b >> 2) & 0x07070707) * wb + 0x10101010) >> 5) & 0x07070707;
+    uint32_t bl = (((a & 0x03030303) * wa + (b & 0x03030303) * wb + 0x10101010) >> 5) & 0x03030303;
+    return (r << 5) | (g << 2) | bl;
+}
+
+static inline uint32_t fade332x4(uint32_t a, uint32_t wa)
+{
+    uint32_t r = ((((a >> 5) & 0x07070707) * wa + 0x10101010) >> 5) & 0x07070707;
+    uint32_t g = ((((a >> 2) & 0x07070707) * wa + 0x10101010) >> 5) & 0x07070707;
+    uint32_t bl = (((a & 0x03030303) * wa + 0x10101010) >> 5) & 0x03030303;
+    return (r << 5) | (g << 2) | bl;
+}
+
+static inline uint32_t uqadd8(uint32_t a, uint32_t b)
+{
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t sum;
+    __asm__("uqadd8 %0, %1, %2" : "=r"(sum) : "r"(a), "r"(b));
+    return sum;
+#else
+    uint32_t sum = ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+    uint32_t carry = ((a & b) | ((a | b) & ~sum)) & 0x80808080;
+    return sum | ((carry >> 7) * 0xFF);
+#endif
+}
+
+// Each channel is moved to the top of its lane, where the saturating lane add
+// saturates exactly the channel
+static inline uint32_t add332x4(uint32_t a, uint32_t b)
+{
+    uint32_t r = uqadd8(a & 0xE0E0E0E0, b & 0xE0E0E0E0) & 0xE0E0E0E0;
+    uint32_t g = uqadd8((a << 3) & 0xE0E0E0E0, (b << 3) & 0xE0E0E0E0) & 0xE0E0E0E0;
+    uint32_t bl = uqadd8((a << 6) & 0xC0C0C0C0, (b << 6) & 0xC0C0C0C0) & 0xC0C0C0C0;
+    return r | (g >> 3) | (bl >> 6);
+}
+
+// G is copied to the upper half so every channel has 5+ clear bits above it:
+// one multiply-accumulate pair blends all three
+static inline uint32_t lerp565x1(uint32_t a, uint32_t b, uint32_t wa, uint32_t wb)
+{
+    uint32_t spread_a = (a | (a << 16)) & 0x07E0F81F;
+    uint32_t spread_b = (b | (b << 16)) & 0x07E0F81F;
+    uint32_t x = ((spread_a * wa + spread_b * wb + 0x02008010) >> 5) & 0x07E0F81F;
+    return (x | (x >> 16)) & 0xFFFF;
+}
+
+// Pixels before p's first word boundary, at most n
+static int head_pixels(const void *p, int n)
+{
+    int head = (4 - ((uintptr_t)p & 3)) & 3;
+    return head < n ? head : n;
+}
+
+static bool co_aligned(const void *a, const void *b, const void *c)
+{
+    return ((((uintptr_t)a ^ (uintptr_t)b) | ((uintptr_t)a ^ (uintptr_t)c)) & 3) == 0;
+}
+
+void pixel_kernels_blend332(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n, uint8_t alpha)
+{
+    uint32_t wb = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    uint32_t wa = PIXEL_KERNELS_ALPHA_MAX - wb;
+    int i = 0;
+    if (co_aligned(dst, a, b))
+    {
+        for (int head = head_pixels(dst, n); i < head; i++)
+            dst[i] = blend332x4(a[i], b[i], wa, wb);
+        for (; i + 4 <= n; i += 4)
+            *(uint32_t *)&dst[i] = blend332x4(*(const uint32_t *)&a[i], *(const uint32_t *)&b[i], wa, wb);
+    }
+    for (; i < n; i++)
+        dst[i] = blend332x4(a[i], b[i], wa, wb);
+}
+
+void pixel_kernels_fade332(uint8_t *dst, const uint8_t *src, int n, uint8_t alpha)
+{
+    uint32_t wa = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    int i = 0;
+    if (co_aligned(dst, src, src))
+    {
+        for (int head = head_pixels(dst, n); i < head; i++)
+            dst[i] = fade332x4(src[i], wa);
+        for (; i + 4 <= n; i += 4)
+            *(uint32_t *)&dst[i] = fade332x4(*(const uint32_t *)&src[i], wa);
+    }
+    for (; i < n; i++)
+        dst[i] = fade332x4(src[i], wa);
+}
+
+void pixel_kernels_add332(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n)
+{
+    int i = 0;
+    if (co_aligned(dst, a, b))
+    {
+        for (int head = head_pixels(dst, n); i < head; i++)
+            dst[i] = add332x4(a[i], b[i]);
+        for (; i + 4 <= n; i += 4)
+            *(uint32_t *)&dst[i] = add332x4(*(const uint32_t *)&a[i], *(const uint32_t *)&b[i]);
+    }
+    for (; i < n; i++)
+        dst[i] = add332x4(a[i], b[i]);
+}
+
+void pixel_kernels_lerp565(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n, uint8_t alpha)
+{
+    uint32_t wb = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    uint32_t wa = PIXEL_KERNELS_ALPHA_MAX - wb;
+    for (int i = 0; i < n; i++)
+        dst[i] = lerp565x1(a[i], b[i], wa, wb);
+}
+
+// References: one channel at a time
+
+static int mix(int ca, int cb, int wa, int wb)
+{
+    return (ca * wa + cb * wb + PIXEL_KERNELS_ALPHA_MAX / 2) / PIXEL_KERNELS_ALPHA_MAX;
+}
+
+void pixel_kernels_blend332_ref(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n, uint8_t alpha)
+{
+    int wb = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    int wa = PIXEL_KERNELS_ALPHA_MAX - wb;
+    for (int i = 0; i < n; i++)
+    {
+        int r = mix(a[i] >> 5, b[i] >> 5, wa, wb);
+        int g = mix((a[i] >> 2) & 7, (b[i] >> 2) & 7, wa, wb);
+        int bl = mix(a[i] & 3, b[i] & 3, wa, wb);
+        dst[i] = (r << 5) | (g << 2) | bl;
+    }
+}
+
+void pixel_kernels_fade332_ref(uint8_t *dst, const uint8_t *src, int n, uint8_t alpha)
+{
+    int wa = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    for (int i = 0; i < n; i++)
+    {
+        int r = mix(src[i] >> 5, 0, wa, 0);
+        int g = mix((src[i] >> 2) & 7, 0, wa, 0);
+        int bl = mix(src[i] & 3, 0, wa, 0);
+        dst[i] = (r << 5) | (g << 2) | bl;
+    }
+}
+
+void pixel_kernels_add332_ref(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int r = (a[i] >> 5) + (b[i] >> 5);
+        int g = ((a[i] >> 2) & 7) + ((b[i] >> 2) & 7);
+        int bl = (a[i] & 3) + (b[i] & 3);
+        dst[i] = ((r < 7 ? r : 7) << 5) | ((g < 7 ? g : 7) << 2) | (bl < 3 ? bl : 3);
+    }
+}
+
+void pixel_kernels_lerp565_ref(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n, uint8_t alpha)
+{
+    int wb = alpha < PIXEL_KERNELS_ALPHA_MAX ? alpha : PIXEL_KERNELS_ALPHA_MAX;
+    int wa = PIXEL_KERNELS_ALPHA_MAX - wb;
+    for (int i = 0; i < n; i++)
+    {
+        int r = mix(a[i] >> 11, b[i] >> 11, wa, wb);
+        int g = mix((a[i] >> 5) & 0x3F, (b[i] >> 5) & 0x3F, wa, wb);
+        int bl = mix(a[i] & 0x1F, b[i] & 0x1F, wa, wb);
+        dst[i] = (r << 11) | (g << 5) | bl;
+    }
+}
+
+bool pixel_kernels_init(void)
+{
+    if (!s_fill_claimed)
+    {
+        s_fill_claimed = true;
+        s_fill_channel = dma_claim_unused_channel(false);
+        if (s_fill_channel < 0)
+        {
+            printf("Pixel kernels: no free DMA channel, fills use the CPU\n");
+        }
+    }
+    return s_fill_channel >= 0;
+}
+
+void pixel_kernels_fill_wait(void)
+{
+    if (s_fill_channel >= 0)
+    {
+        dma_channel_wait_for_finish_blocking(s_fill_channel);
+    }
+}
+
+void pixel_kernels_fill(void *dst, uint8_t value, size_t bytes)
+{
+    pixel_kernels_init();
+    pixel_kernels_fill_wait();
+
+    uint8_t *p = dst;
+    size_t head = head_pixels(p, bytes < 4 ? (int)bytes : 4);
+    size_t words = (bytes - head) / 4;
+    size_t tail = bytes - head - words * 4;
+    memset(p, value, head);
+    memset(&p[head + words * 4], value, tail);
+    if (words == 0)
+    {
+        return;
+    }
+    if (s_fill_channel < 0)
+    {
+        memset(&p[head], value, words * 4);
+        return;
+    }
+
+    s_fill_word = value * 0x01010101u;
+    dma_channel_config c = dma_channel_get_default_config(s_fill_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    dma_channel_configure(s_fill_channel, &c, &p[head], &s_fill_word, words, true);
+}
+
+// Bench buffers, RGB565-sized
+static uint8_t *s_bench_a;
+static uint8_t *s_bench_b;
+static uint8_t *s_bench_out;
+static uint8_t *s_bench_ref;
+
+static void run_blend332(uint8_t *dst, bool ref)
+{
+    (ref ? pixel_kernels_blend332_ref : pixel_kernels_blend332)(dst, s_bench_a, s_bench_b, PIXEL_KERNELS_BENCH_PIXELS, 11);
+}
+
+static void run_fade332(uint8_t *dst, bool ref)
+{
+    (ref ? pixel_kernels_fade332_ref : pixel_kernels_fade332)(dst, s_bench_a, PIXEL_KERNELS_BENCH_PIXELS, 19);
+}
+
+static void run_add332(uint8_t *dst, bool ref)
+{
+    (ref ? pixel_kernels_add332_ref : pixel_kernels_add332)(dst, s_bench_a, s_bench_b, PIXEL_KERNELS_BENCH_PIXELS);
+}
+
+static void run_lerp565(uint8_t *dst, bool ref)
+{
+    (ref ? pixel_kernels_lerp565_ref : pixel_kernels_lerp565)((uint16_t *)dst, (const uint16_t *)s_bench_a,
+                                                             (const uint16_t *)s_bench_b, PIXEL_KERNELS_BENCH_PIXELS, 11);
+}
+
+// The DMA fill against memset as its reference
+static void run_fill(uint8_t *dst, bool ref)
+{
+    if (ref)
+    {
+        memset(dst, 0x5A, PIXEL_KERNELS_BENCH_PIXELS);
+    }
+    else
+    {
+        pixel_kernels_fill(dst, 0x5A, PIXEL_KERNELS_BENCH_PIXELS);
+        pixel_kernels_fill_wait();
+    }
+}
+
+static void bench_kernel(const char *name, void (*run)(uint8_t *dst, bool ref), size_t out_bytes, float cycles_per_us)
+{
+    uint32_t us[2];
+    for (int ref = 0; ref < 2; ref++)
+    {
+        uint8_t *dst = ref ? s_bench_ref : s_bench_out;
+        memset(dst, 0xA5, out_bytes);
+        uint32_t t0 = time_us_32();
+        for (int i = 0; i < PIXEL_KERNELS_BENCH_REPEATS; i++)
+        {
+            run(dst, ref);
+        }
+        us[ref] = time_us_32() - t0;
+    }
+    float pixels = (float)PIXEL_KERNELS_BENCH_PIXELS * PIXEL_KERNELS_BENCH_REPEATS;
+    float fast = us[0] * cycles_per_us / pixels;
+    float ref = us[1] * cycles_per_us / pixels;
+    printf("  %-9s %6.2f cycles/pixel, reference %6.2f (%.1fx)%s\n", name, fast, ref, fast > 0 ? ref / fast : 0.0f,
+           memcmp(s_bench_out, s_bench_ref, out_bytes) == 0 ? "" : " MISMATCH");
+}
+
+void pixel_kernels_bench(void)
+{
+    size_t bytes = PIXEL_KERNELS_BENCH_PIXELS * sizeof(uint16_t);
+    s_bench_a = malloc(bytes);
+    s_bench_b = malloc(bytes);
+    s_bench_out = malloc(bytes);
+    s_bench_ref = malloc(bytes);
+    if (s_bench_a != NULL && s_bench_b != NULL && s_bench_out != NULL && s_bench_ref != NULL)
+    {
+        uint32_t seed = 1;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            s_bench_a[i] = seed >> 24;
+            s_bench_b[i] = seed >> 16;
+        }
+
+        float cycles_per_us = clock_get_hz(clk_sys) / 1e6f;
+        printf("Pixel kernels (%d pixels x %d):\n", PIXEL_KERNELS_BENCH_PIXELS, PIXEL_KERNELS_BENCH_REPEATS);
+        bench_kernel("blend332", run_blend332, PIXEL_KERNELS_BENCH_PIXELS, cycles_per_us);
+        bench_kernel("fade332", run_fade332, PIXEL_KERNELS_BENCH_PIXELS, cycles_per_us);
+        bench_kernel("add332", run_add332, PIXEL_KERNELS_BENCH_PIXELS, cycles_per_us);
+        bench_kernel("lerp565", run_lerp565, bytes, cycles_per_us);
+        bench_kernel("fill", run_fill, PIXEL_KERNELS_BENCH_PIXELS, cycles_per_us);
+    }
+    else
+    {
+        printf("Pixel kernels: no RAM for the bench buffers\n");
+    }
+    free(s_bench_a);
+    free(s_bench_b);
+    free(s_bench_out);
+    free(s_bench_ref);
+}
@@ -0,0 +1,54 @@
+#ifndef __PIXEL_KERNELS_H__
+#define __PIXEL_KERNELS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define PIXEL_KERNELS_ALPHA_MAX 32 // alpha = 32 is all of b (or of the source for a fade)
+#define PIXEL_KERNELS_BENCH_PIXELS 4096
+#define PIXEL_KERNELS_BENCH_REPEATS 32
+
+// Row kernels. Rows may have any alignment; words are processed when all the
+// rows involved share one, pixel by pixel otherwise. dst may be one of the
+// sources. Each has a plain per-pixel _ref version with identical results,
+// for host tests and for checking the fast one on the target.
+//
+// The fast versions work on 4 RGB332 pixels (or 1 RGB565 pixel) per word with
+// multiplies that can't carry between channels. With __ARM_FEATURE_DSP (the
+// M33) the saturating add uses UQADD8; without it (RISC-V, host builds) the
+// same kernels fall back to portable SWAR code.
+
+// RGB332 crossfade: every channel a + (b - a) * alpha / 32, rounded
+void pixel_kernels_blend332(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n, uint8_t alpha);
+void pixel_kernels_blend332_ref(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n, uint8_t alpha);
+
+// RGB332 fade to black: every channel times alpha / 32, rounded
+void pixel_kernels_fade332(uint8_t *dst, const uint8_t *src, int n, uint8_t alpha);
+void pixel_kernels_fade332_ref(uint8_t *dst, const uint8_t *src, int n, uint8_t alpha);
+
+// RGB332 additive blend, every channel saturating at its maximum
+void pixel_kernels_add332(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n);
+void pixel_kernels_add332_ref(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n);
+
+// RGB565 crossfade: every channel a + (b - a) * alpha / 32, rounded
+void pixel_kernels_lerp565(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n, uint8_t alpha);
+void pixel_kernels_lerp565_ref(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n, uint8_t alpha);
+
+// Claims the DMA channel for pixel_kernels_fill, once. The first fill calls it,
+// so no channel is taken unless fills are used. Returns false if none was free
+// (fills are then done by the CPU).
+bool pixel_kernels_init(void);
+
+// Fills bytes with value: the word-aligned middle by DMA, which is left
+// running, the ends by the CPU. Wait before reading dst or filling again.
+void pixel_kernels_fill(void *dst, uint8_t value, size_t bytes);
+void pixel_kernels_fill_wait(void);
+
+// Times every kernel against its reference over PIXEL_KERNELS_BENCH_PIXELS
+// pixels, checks they agree, and prints cycles per pixel. The fill DMA must
+// be idle.
+void pixel_kernels_bench(void);
+
+#endif // __PIXEL_KERNELS_H__
@@ -0,0 +1,249 @@
+#include "playlist.h"
+#include "ff.h"
+
+_Static_assert(sizeof(playlist_index_header_t) == 12, "index header layout");
+_Static_assert(sizeof(playlist_clip_t) == 32, "index clip record layout");
+_Static_assert(sizeof(playlist_frame_t) == 16, "index frame record layout");
+
+playlist_info_t *g_playlist_info;
+
+static playlist_clip_t s_clips[PLAYLIST_MAX_CLIPS];
+static playlist_frame_t s_frames[PLAYLIST_MAX_FRAMES];
+static uint16_t s_duration_ms[PLAYLIST_MAX_FRAMES]; // Copy of s_frames[].duration_ms for the scheduler
+
+static uint32_t fnv1a(const char *s)
+{
+    uint32_t hash = 2166136261u;
+    while (*s)
+    {
+        hash ^= (uint8_t)*s++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Reads the whole binary index: header, then both record tables straight into place
+static bool load_index(const char *path)
+{
+    playlist_info_t *info = g_playlist_info;
+    FIL fil;
+    UINT bytes_read;
+    playlist_index_header_t header;
+
+    if (f_open(&fil, path, FA_READ) != FR_OK)
+        return false;
+
+    bool ok = f_read(&fil, &header, sizeof(header), &bytes_read) == FR_OK && bytes_read == sizeof(header) &&
+              header.magic == PLAYLIST_INDEX_MAGIC && header.version == PLAYLIST_INDEX_VERSION &&
+              header.clip_count <= PLAYLIST_MAX_CLIPS && header.frame_count <= PLAYLIST_MAX_FRAMES;
+    if (ok)
+    {
+        UINT clips_size = header.clip_count * sizeof(playlist_clip_t);
+        UINT frames_size = header.frame_count * sizeof(playlist_frame_t);
+        ok = f_read(&fil, s_clips, clips_size, &bytes_read) == FR_OK && bytes_read == clips_size &&
+             f_read(&fil, s_frames, frames_size, &bytes_read) == FR_OK && bytes_read == frames_size;
+    }
+    f_close(&fil);
+
+    if (!ok)
+    {
+        printf("Playlist: %s is damaged or from another version, falling back to the manifest\n", path);
+        return false;
+    }
+
+    for (int i = 0; i < header.clip_count; i++)
+    {
+        s_clips[i].name[PLAYLIST_NAME_LEN - 1] = '\0';
+        if (s_clips[i].first_frame + s_clips[i].frame_count > header.frame_count)
+        {
+            printf("Playlist: %s clip %d runs past the frame table, falling back to the manifest\n", path, i);
+            return false;
+        }
+    }
+    for (int i = 0; i < header.frame_count; i++)
+    {
+        if (s_frames[i].clip >= header.clip_count)
+        {
+            printf("Playlist: %s frame %d has no clip, falling back to the manifest\n", path, i);
+            return false;
+        }
+    }
+    info->clip_count = header.clip_count;
+    info->frame_count = header.frame_count;
+    return true;
+}
+
+// Splits "<name>-<n>.bin [ms]" in place. Returns false if the line doesn't match.
+static bool parse_line(char *line, char **name, int *file_index, unsigned int *duration_ms)
+{
+    char *end = strstr(line, ".bin");
+    if (end == NULL)
+        return false;
+    *end = '\0';
+
+    char *dash = strrchr(line, '-');
+    if (dash == NULL || dash == line || dash[1] == '\0')
+        return false;
+
+    char *digits_end;
+    long n = strtol(dash + 1, &digits_end, 10);
+    if (*digits_end != '\0' || n < 0 || n > UINT16_MAX)
+        return false;
+
+    *dash = '\0';
+    *name = line;
+    *file_index = n;
+    if (sscanf(end + 4, "%u", duration_ms) != 1)
+    {
+        *duration_ms = g_playlist_info->default_duration_ms;
+    }
+    return true;
+}
+
+// Starts a new clip when the base name changes. Returns false when the tables are full.
+static bool clip_for_name(const char *name)
+{
+    playlist_info_t *info = g_playlist_info;
+    if (info->clip_count > 0 && strcmp(s_clips[info->clip_count - 1].name, name) == 0)
+        return true;
+
+    if (info->clip_count >= PLAYLIST_MAX_CLIPS || strlen(name) >= PLAYLIST_NAME_LEN)
+        return false;
+
+    playlist_clip_t *clip = &s_clips[info->clip_count++];
+    clip->name_hash = fnv1a(name);
+    clip->first_frame = info->frame_count;
+    clip->frame_count = 0;
+    strcpy(clip->name, name);
+    return true;
+}
+
+static bool parse_manifest(const char *path)
+{
+    playlist_info_t *info = g_playlist_info;
+    FIL fil;
+    if (f_open(&fil, path, FA_READ) != FR_OK)
+    {
+        printf("Playlist: no %s\n", path);
+        return false;
+    }
+
+    char line[PLAYLIST_MAX_PATH];
+    while (f_gets(line, sizeof(line), &fil))
+    {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] != '\n' && !f_eof(&fil))
+        {
+            // Longer than the buffer: drop the rest of it too, rather than reading it as another line
+            while (f_gets(line, sizeof(line), &fil) && line[strlen(line) - 1] != '\n')
+            {
+            }
+            info->lines_skipped++;
+            continue;
+        }
+
+        char *name;
+        int file_index;
+        unsigned int duration_ms;
+        if (!parse_line(line, &name, &file_index, &duration_ms))
+        {
+            info->lines_skipped++;
+            continue;
+        }
+
+        if (info->frame_count >= PLAYLIST_MAX_FRAMES || !clip_for_name(name))
+        {
+            printf("Playlist: table full or clip name too long, ignoring the rest of %s\n", path);
+            break;
+        }
+
+        playlist_frame_t *frame = &s_frames[info->frame_count++];
+        frame->clip = info->clip_count - 1;
+        frame->file_index = file_index;
+        frame->duration_ms = duration_ms > UINT16_MAX ? UINT16_MAX : duration_ms;
+        frame->reserved = 0;
+        frame->file_size = 0;
+        frame->cluster_hint = 0;
+        s_clips[info->clip_count - 1].frame_count++;
+    }
+    f_close(&fil);
+    return true;
+}
+
+bool playlist_init(playlist_info_t *playlist_info)
+{
+    g_playlist_info = playlist_info;
+    playlist_info->clip_count = 0;
+    playlist_info->frame_count = 0;
+    playlist_info->lines_skipped = 0;
+    uint32_t start_us = time_us_32();
+
+    char path[PLAYLIST_MAX_PATH];
+    snprintf(path, sizeof(path), "%sindex.bin", playlist_info->dir);
+    playlist_info->from_index = load_index(path);
+    if (!playlist_info->from_index)
+    {
+        playlist_info->clip_count = 0;
+        playlist_info->frame_count = 0;
+        snprintf(path, sizeof(path), "%smanifest.txt", playlist_info->dir);
+        parse_manifest(path);
+    }
+
+    for (int i = 0; i < playlist_info->frame_count; i++)
+    {
+        s_duration_ms[i] = s_frames[i].duration_ms;
+    }
+    playlist_info->load_us = time_us_32() - start_us;
+
+    printf("Playlist: %u frames in %u clips from %s in %u us (%u lines skipped)\n",
+           playlist_info->frame_count, playlist_info->clip_count, path, playlist_info->load_us,
+           playlist_info->lines_skipped);
+    return playlist_info->frame_count > 0;
+}
+
+playlist_info_t *playlist_get_info(void)
+{
+    return g_playlist_info;
+}
+
+const playlist_clip_t *playlist_get_clip(int clip_index)
+{
+    if (clip_index < 0 || clip_index >= g_playlist_info->clip_count)
+        return NULL;
+    return &s_clips[clip_index];
+}
+
+const playlist_frame_t *playlist_get_frame(int frame_index)
+{
+    if (frame_index < 0 || frame_index >= g_playlist_info->frame_count)
+        return NULL;
+    return &s_frames[frame_index];
+}
+
+const char *playlist_clip_name(int clip_index)
+{
+    const playlist_clip_t *clip = playlist_get_clip(clip_index);
+    return clip != NULL ? clip->name : NULL;
+}
+
+int playlist_clip_of(int frame_index)
+{
+    const playlist_frame_t *frame = playlist_get_frame(frame_index);
+    return frame != NULL ? frame->clip : -1;
+}
+
+const uint16_t *playlist_durations_ms(void)
+{
+    return s_duration_ms;
+}
+
+bool playlist_frame_path(int frame_index, char *path, size_t path_len)
+{
+    const playlist_frame_t *frame = playlist_get_frame(frame_index);
+    if (frame == NULL)
+        return false;
+
+    int len = snprintf(path, path_len, "%s%s-%u.bin",
+                       g_playlist_info->dir, s_clips[frame->clip].name, frame->file_index);
+    return len > 0 && (size_t)len < path_len;
+}
@@ -0,0 +1,78 @@
+#ifndef __PLAYLIST_H__
+#define __PLAYLIST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "frame_cache.h"
+
+#define PLAYLIST_MAX_FRAMES FRAME_CACHE_MAX_FRAMES // Frame numbers double as frame cache keys
+#define PLAYLIST_MAX_CLIPS 32
+#define PLAYLIST_NAME_LEN 24                       // Clip base name including the NUL
+#define PLAYLIST_MAX_PATH 96
+
+// index.bin, written by convert.py next to manifest.txt. Little-endian:
+// header, clip_count clip records, frame_count frame records. The records
+// below are the in-memory tables too, so loading is three f_reads.
+#define PLAYLIST_INDEX_MAGIC 0x58494C50u // "PLIX"
+#define PLAYLIST_INDEX_VERSION 1
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t clip_count;
+    uint16_t frame_count;
+    uint16_t reserved;
+} playlist_index_header_t;
+
+// One clip: frames "<name>-<n>.bin" occupying playlist frames [first_frame, first_frame + frame_count)
+typedef struct
+{
+    uint32_t name_hash; // FNV-1a of name
+    uint16_t first_frame;
+    uint16_t frame_count;
+    char name[PLAYLIST_NAME_LEN];
+} playlist_clip_t;
+
+typedef struct
+{
+    uint16_t clip;
+    uint16_t file_index;   // <n> in "<name>-<n>.bin"
+    uint16_t duration_ms;
+    uint16_t reserved;
+    uint32_t file_size;    // 0 if unknown (text manifest)
+    uint32_t cluster_hint; // First cluster when the file is known to be contiguous, else 0
+} playlist_frame_t;
+
+typedef struct
+{
+    const char *dir;              // Directory holding index.bin / manifest.txt and the frames, with trailing '/'
+    uint16_t default_duration_ms; // For manifest lines without a duration
+
+    // Parsed table
+    uint16_t clip_count;
+    uint16_t frame_count;
+    uint16_t lines_skipped; // Manifest lines that weren't "<name>-<n>.bin [ms]"
+    bool from_index;        // Loaded from index.bin rather than parsed from manifest.txt
+    uint32_t load_us;       // Time taken by playlist_init
+} playlist_info_t;
+
+// Loads <dir>index.bin, or parses <dir>manifest.txt if there is no usable index.
+// Returns false if neither names any frames.
+bool playlist_init(playlist_info_t *playlist_info);
+playlist_info_t *playlist_get_info(void);
+
+const playlist_clip_t *playlist_get_clip(int clip_index);
+const playlist_frame_t *playlist_get_frame(int frame_index);
+const char *playlist_clip_name(int clip_index);
+int playlist_clip_of(int frame_index);
+
+// Display durations of all playlist frames, indexed by playlist frame number
+const uint16_t *playlist_durations_ms(void);
+
+// Full path of a playlist frame. Returns false if frame_index is out of range or the path doesn't fit.
+bool playlist_frame_path(int frame_index, char *path, size_t path_len);
+
+#endif // __PLAYLIST_H__
@@ -0,0 +1,227 @@
+#include "prefetch.h"
+#include "frame_cache.h"
+
+prefetch_info_t *g_prefetch_info;
+
+static uint16_t s_histogram[PREFETCH_LATENCY_BUCKETS];
+static uint32_t s_samples;       // Sum of s_histogram
+static uint32_t s_since_decay;
+static uint32_t s_last_frame_us;
+static uint16_t s_below_frames;  // Consecutive frames the target depth stayed below depth
+static uint16_t s_base_min_depth; // min_depth as given to prefetch_init
+
+static prefetch_underrun_t s_log[PREFETCH_UNDERRUN_LOG];
+static uint8_t s_log_head;
+static uint8_t s_log_count;
+
+static int bucket_of(uint32_t latency_us)
+{
+    uint32_t ms = latency_us / 1000;
+    if (ms < 32)
+        return ms;
+    uint32_t bucket = 32 + (ms - 32) / 16;
+    return bucket < PREFETCH_LATENCY_BUCKETS ? bucket : PREFETCH_LATENCY_BUCKETS - 1;
+}
+
+static uint32_t bucket_upper_us(int bucket)
+{
+    if (bucket < 32)
+        return (bucket + 1) * 1000;
+    return (32 + (bucket - 31) * 16) * 1000;
+}
+
+static void record_latency(uint32_t latency_us)
+{
+    s_histogram[bucket_of(latency_us)]++;
+    s_samples++;
+
+    if (++s_since_decay >= PREFETCH_DECAY_INTERVAL)
+    {
+        s_samples = 0;
+        for (int i = 0; i < PREFETCH_LATENCY_BUCKETS; i++)
+        {
+            s_histogram[i] >>= 1;
+            s_samples += s_histogram[i];
+        }
+        s_since_decay = 0;
+    }
+
+    // Smallest bucket bound that covers 99% of the (decayed) samples
+    uint32_t needed = s_samples - s_samples / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < PREFETCH_LATENCY_BUCKETS; i++)
+    {
+        seen += s_histogram[i];
+        if (seen >= needed)
+        {
+            g_prefetch_info->p99_us = bucket_upper_us(i);
+            break;
+        }
+    }
+}
+
+// Grow immediately when the card gets slower, shrink one frame at a time once it has been fast for a while
+static void update_depth(void)
+{
+    prefetch_info_t *info = g_prefetch_info;
+    if (info->frame_period_us == 0)
+        return;
+
+    uint32_t target = (info->p99_us + info->frame_period_us - 1) / info->frame_period_us + 1;
+    if (target < info->min_depth)
+        target = info->min_depth;
+    if (target > info->max_depth)
+        target = info->max_depth;
+
+    if (target > info->depth)
+    {
+        info->depth = target;
+        s_below_frames = 0;
+    }
+    else if (target < info->depth)
+    {
+        if (++s_below_frames >= PREFETCH_SHRINK_INTERVAL)
+        {
+            info->depth--;
+            s_below_frames = 0;
+        }
+    }
+    else
+    {
+        s_below_frames = 0;
+    }
+}
+
+static bool timed_load(int frame_index)
+{
+    uint32_t t0 = time_us_32();
+    bool ok = g_prefetch_info->load(frame_index);
+    g_prefetch_info->loads++;
+    if (ok)
+    {
+        record_latency(time_us_32() - t0);
+    }
+    else
+    {
+        g_prefetch_info->load_failures++;
+    }
+    return ok;
+}
+
+void prefetch_init(prefetch_info_t *prefetch_info)
+{
+    g_prefetch_info = prefetch_info;
+
+    if (prefetch_info->min_depth < 1)
+        prefetch_info->min_depth = 1;
+    if (prefetch_info->max_depth < prefetch_info->min_depth)
+        prefetch_info->max_depth = prefetch_info->min_depth;
+    s_base_min_depth = prefetch_info->min_depth;
+
+    prefetch_info->depth = prefetch_info->max_depth; // Start deep, shrink once latency is known
+    prefetch_info->p99_us = 0;
+    prefetch_info->frame_period_us = 0;
+    prefetch_info->loads = 0;
+    prefetch_info->load_failures = 0;
+    prefetch_info->underruns = 0;
+    prefetch_info->cancelled = 0;
+
+    memset(s_histogram, 0, sizeof(s_histogram));
+    s_samples = 0;
+    s_since_decay = 0;
+    s_last_frame_us = 0;
+    s_below_frames = 0;
+    s_log_head = 0;
+    s_log_count = 0;
+}
+
+prefetch_info_t *prefetch_get_info(void)
+{
+    return g_prefetch_info;
+}
+
+void prefetch_run(int current_frame, int total_frames, int skip_frames)
+{
+    prefetch_info_t *info = g_prefetch_info;
+
+    uint32_t now_us = time_us_32();
+    if (s_last_frame_us != 0)
+    {
+        uint32_t period_us = now_us - s_last_frame_us;
+        info->frame_period_us = info->frame_period_us ? (info->frame_period_us * 7 + period_us) / 8 : period_us;
+    }
+    s_last_frame_us = now_us;
+
+    update_depth();
+
+    // The frame on screen and the frames about to be dropped are done with; keep the look-ahead window
+    if (skip_frames > total_frames - 2)
+        skip_frames = total_frames - 2;
+    if (skip_frames < 0)
+        skip_frames = 0;
+    int first = (current_frame + 1 + skip_frames) % total_frames;
+    frame_cache_set_protected(first, info->depth, total_frames);
+
+    int issued = 0;
+    for (int k = 0; k < info->depth && k < total_frames - 1 - skip_frames; k++)
+    {
+        int frame_index = (first + k) % total_frames;
+        if (frame_cache_contains(frame_index))
+            continue;
+
+        timed_load(frame_index);
+        if (++issued >= PREFETCH_MAX_LOADS_PER_FRAME)
+            break;
+    }
+}
+
+void prefetch_set_min_depth(uint16_t min_depth)
+{
+    prefetch_info_t *info = g_prefetch_info;
+    if (min_depth < s_base_min_depth)
+        min_depth = s_base_min_depth;
+    if (min_depth > info->max_depth)
+        min_depth = info->max_depth;
+    info->min_depth = min_depth;
+}
+
+void prefetch_underrun(int current_frame)
+{
+    prefetch_info_t *info = g_prefetch_info;
+    info->underruns++;
+
+    prefetch_underrun_t *event = &s_log[(s_log_head + s_log_count) % PREFETCH_UNDERRUN_LOG];
+    if (s_log_count < PREFETCH_UNDERRUN_LOG)
+    {
+        s_log_count++;
+    }
+    else
+    {
+        s_log_head = (s_log_head + 1) % PREFETCH_UNDERRUN_LOG; // Overwrite the oldest
+    }
+    event->frame_index = current_frame;
+    event->time_ms = to_ms_since_boot(get_absolute_time());
+    event->depth = info->depth;
+    event->p99_us = info->p99_us;
+
+    timed_load(current_frame);
+}
+
+void prefetch_cancel(int current_frame)
+{
+    if (!frame_cache_contains(current_frame))
+    {
+        g_prefetch_info->cancelled++;
+    }
+}
+
+bool prefetch_pop_underrun(prefetch_underrun_t *event)
+{
+    if (s_log_count == 0)
+        return false;
+
+    *event = s_log[s_log_head];
+    s_log_head = (s_log_head + 1) % PREFETCH_UNDERRUN_LOG;
+    s_log_count--;
+    return true;
+}
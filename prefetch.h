@@ -0,0 +1,63 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define PREFETCH_LATENCY_BUCKETS 64      // Histogram: 1 ms buckets to 32 ms, then 16 ms buckets to ~528 ms
+#define PREFETCH_DECAY_INTERVAL 128      // Halve the histogram every N loads so old spikes age out
+#define PREFETCH_SHRINK_INTERVAL 32      // Frames the target must stay below depth before shrinking by one
+#define PREFETCH_MAX_LOADS_PER_FRAME 2   // Catch-up loads allowed per displayed frame
+#define PREFETCH_UNDERRUN_LOG 8          // Underrun events kept for the host to drain
+
+typedef bool (*prefetch_load_t)(int frame_index);
+
+typedef struct
+{
+    int frame_index;      // Frame that wasn't ready when it was due
+    uint32_t time_ms;     // Since boot
+    uint16_t depth;       // Look-ahead at the time
+    uint32_t p99_us;      // Latency estimate at the time
+} prefetch_underrun_t;
+
+typedef struct
+{
+    uint16_t min_depth;
+    uint16_t max_depth;   // Slot budget minus the frame on screen
+    prefetch_load_t load; // Loads one frame into the cache, returns false on failure
+
+    // State, updated by the prefetcher
+    uint16_t depth;            // Current look-ahead in frames
+    uint32_t p99_us;           // Moving p99 of frame load latency
+    uint32_t frame_period_us;  // EMA of display period
+    uint32_t loads;
+    uint32_t load_failures;
+    uint32_t underruns;
+    uint32_t cancelled;        // Dropped frames whose read was never issued
+} prefetch_info_t;
+
+void prefetch_init(prefetch_info_t *prefetch_info);
+prefetch_info_t *prefetch_get_info(void);
+
+// Called once per displayed or dropped frame with the frame now on screen.
+// The skip_frames frames after it are going to be dropped: they are left out
+// of the look-ahead window so their reads are never issued.
+void prefetch_run(int current_frame, int total_frames, int skip_frames);
+
+// Raises the look-ahead floor, e.g. while a crossfade needs frames further
+// ahead; never below the min_depth given to prefetch_init, never above
+// max_depth. The depth follows at the next prefetch_run.
+void prefetch_set_min_depth(uint16_t min_depth);
+
+// Reports that current_frame was dropped; counts its read as cancelled if it was never loaded
+void prefetch_cancel(int current_frame);
+
+// Reports that current_frame was not cached when it was due and loads it synchronously
+void prefetch_underrun(int current_frame);
+
+// Pops the oldest logged underrun. Returns false when the log is empty.
+bool prefetch_pop_underrun(prefetch_underrun_t *event);
+
+#endif // __PREFETCH_H__
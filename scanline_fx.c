@@ -0,0 +1,331 @@
+#include "scanline_fx.h"
+#include "pixel_kernels.h"
+#include "hardware/clocks.h"
+
+scanline_fx_info_t *g_scanline_fx_info;
+
+// Declared cost in CPU cycles per 4 pixels, averaged over a frame's rows: {full, degraded},
+// a degraded cost of 0 means the effect has no degraded mode
+static const uint8_t s_cost[SCANLINE_FX_COUNT][2] = {
+    [SCANLINE_FX_GLITCH] = {2, 0},  // Only the rows of a glitch block do any work, one memmove
+    [SCANLINE_FX_PALETTE] = {7, 0}, // Load, UADD8, USUB8, SEL, store
+    [SCANLINE_FX_FADE] = {20, 6},   // Three masked multiplies / one shift and mask
+    [SCANLINE_FX_DARKEN] = {3, 0},  // One shift and mask, every other row
+};
+
+static uint32_t s_cycles_per_us;
+static uint32_t s_budget_us;
+static uint16_t s_calm_frames; // Frames in a row with room for the next step up
+
+// Frozen for the frame by scanline_fx_begin_frame()
+static uint8_t s_palette_offset;
+static uint32_t s_palette_add; // The offset in every byte lane
+static uint8_t s_fade_level;
+
+static uint32_t s_random = 0x2545F491;
+static int s_glitch_rows_left;
+static int s_glitch_start;
+static int s_glitch_length;
+static int s_glitch_offset;
+
+static uint32_t next_random(void)
+{
+    // xorshift32
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
+
+// The pixel operations below work on 4 RGB332 pixels in a word and never carry
+// from one byte lane into the next, so they also work on a single pixel.
+
+// Adds the palette offset to every non-black pixel; black stays black so the
+// panel keeps skipping it
+static inline uint32_t palette_rotate4(uint32_t pixels, uint32_t add)
+{
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t rotated, scratch;
+    __asm__("uadd8 %0, %2, %3\n\t"
+            "usub8 %1, %2, %4\n\t" // GE set in the non-black lanes
+            "sel %0, %0, %2"
+            : "=&r"(rotated), "=&r"(scratch)
+            : "r"(pixels), "r"(add), "r"(0x01010101u));
+    return rotated;
+#else
+    uint32_t sum = ((pixels & 0x7F7F7F7F) + (add & 0x7F7F7F7F)) ^ ((pixels ^ add) & 0x80808080);
+    uint32_t lit = (pixels | ((pixels & 0x7F7F7F7F) + 0x7F7F7F7F)) & 0x80808080;
+    return sum & ((lit >> 7) * 0xFF);
+#endif
+}
+
+// Every channel halved: the mask drops the bit each field takes from the one above it
+static inline uint32_t half4(uint32_t pixels)
+{
+    return (pixels >> 1) & 0x6D6D6D6D;
+}
+
+static inline uint32_t quarter4(uint32_t pixels)
+{
+    return (pixels >> 2) & 0x24242424;
+}
+
+// Splits a row into bytes up to word alignment, whole words, and the bytes after them
+static uint32_t *align_row(uint8_t *row, int n, int *head, int *words, int *tail)
+{
+    int to_word = (4 - ((uintptr_t)row & 3)) & 3;
+    *head = to_word < n ? to_word : n;
+    *words = (n - *head) / 4;
+    *tail = n - *head - *words * 4;
+    return (uint32_t *)&row[*head];
+}
+
+// Runs `op` (an expression of `pixels`) over a row: single pixels up to word alignment, then
+// 4 at a time, then the single pixels after the last word
+#define FOR_EACH_PIXEL_WORD(row, n, op)                           \
+    do                                                            \
+    {                                                             \
+        int head, words, tail;                                    \
+        uint32_t *word = align_row(row, n, &head, &words, &tail); \
+        for (int i = 0; i < head; i++)                            \
+        {                                                         \
+            uint32_t pixels = row[i];                             \
+            row[i] = op;                                          \
+        }                                                         \
+        for (int i = 0; i < words; i++)                           \
+        {                                                         \
+            uint32_t pixels = word[i];                            \
+            word[i] = op;                                         \
+        }                                                         \
+        uint8_t *rest = (uint8_t *)&word[words];                  \
+        for (int i = 0; i < tail; i++)                            \
+        {                                                         \
+            uint32_t pixels = rest[i];                            \
+            rest[i] = op;                                         \
+        }                                                         \
+    } while (0)
+
+static void glitch_row(uint8_t *row, int n)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    if (s_glitch_rows_left == 0)
+    {
+        int max_length = info->glitch_max_length < n ? info->glitch_max_length : n;
+        if (info->glitch_chance == 0 || max_length < 1 || (next_random() & 0xFFFF) >= info->glitch_chance)
+        {
+            return;
+        }
+        int max_rows = info->glitch_max_rows > 0 ? info->glitch_max_rows : 1;
+        int max_offset = info->glitch_max_offset > 0 ? info->glitch_max_offset : 1;
+        s_glitch_rows_left = 1 + next_random() % max_rows;
+        s_glitch_length = 1 + next_random() % max_length;
+        s_glitch_start = next_random() % (n - s_glitch_length + 1);
+        s_glitch_offset = 1 + next_random() % max_offset;
+        if (next_random() & 1)
+        {
+            s_glitch_offset = -s_glitch_offset;
+        }
+    }
+    s_glitch_rows_left--;
+
+    // Shift the span, clipped to the row
+    int from = s_glitch_start;
+    int to = from + s_glitch_offset;
+    int length = s_glitch_length;
+    if (to < 0)
+    {
+        from -= to;
+        length += to;
+        to = 0;
+    }
+    if (to + length > n)
+    {
+        length = n - to;
+    }
+    if (length > 0)
+    {
+        memmove(&row[to], &row[from], length);
+    }
+}
+
+static uint8_t effect_cost(int id, scanline_fx_level_t level)
+{
+    if (level == SCANLINE_FX_OFF)
+        return 0;
+    return s_cost[id][level == SCANLINE_FX_FULL ? 0 : 1];
+}
+
+static scanline_fx_level_t level_down(int id, scanline_fx_level_t level)
+{
+    if (level == SCANLINE_FX_FULL && s_cost[id][1] != 0)
+        return SCANLINE_FX_DEGRADED;
+    return SCANLINE_FX_OFF;
+}
+
+static scanline_fx_level_t level_up(int id, scanline_fx_level_t level)
+{
+    if (level == SCANLINE_FX_OFF && s_cost[id][1] != 0)
+        return SCANLINE_FX_DEGRADED;
+    return SCANLINE_FX_FULL;
+}
+
+static uint32_t cycles_to_us(uint32_t cycles_per_word)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    uint32_t words = (uint32_t)(info->width + 3) / 4 * info->height;
+    return (cycles_per_word * words + s_cycles_per_us - 1) / s_cycles_per_us;
+}
+
+void scanline_fx_init(scanline_fx_info_t *fx_info)
+{
+    g_scanline_fx_info = fx_info;
+    s_cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+    if (s_cycles_per_us == 0)
+        s_cycles_per_us = 1;
+
+    for (int i = 0; i < SCANLINE_FX_COUNT; i++)
+    {
+        fx_info->level[i] = fx_info->enabled[i] ? SCANLINE_FX_FULL : SCANLINE_FX_OFF;
+    }
+    s_budget_us = 0;
+    s_calm_frames = 0;
+    s_palette_offset = 0;
+    s_glitch_rows_left = 0;
+    scanline_fx_reset_stats();
+}
+
+scanline_fx_info_t *scanline_fx_get_info(void)
+{
+    return g_scanline_fx_info;
+}
+
+void scanline_fx_reset_stats(void)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    info->frames = 0;
+    info->fx_us = 0;
+    info->over_budget = 0;
+    info->shed = 0;
+    info->restored = 0;
+}
+
+uint32_t scanline_fx_cost_us(const scanline_fx_level_t *level)
+{
+    uint32_t cycles = 0;
+    for (int i = 0; i < SCANLINE_FX_COUNT; i++)
+    {
+        cycles += effect_cost(i, level[i]);
+    }
+    return cycles_to_us(cycles);
+}
+
+void scanline_fx_begin_frame(uint32_t budget_us)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    s_budget_us = budget_us;
+    if (info->level[SCANLINE_FX_PALETTE] != SCANLINE_FX_OFF)
+    {
+        s_palette_offset += info->palette_step;
+    }
+    s_palette_add = s_palette_offset * 0x01010101u;
+    s_fade_level = info->fade_level < 8 ? info->fade_level : 8;
+}
+
+void scanline_fx_apply_row(int y, uint8_t *row)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    uint32_t t0 = time_us_32();
+    int n = info->width;
+
+    if (info->level[SCANLINE_FX_GLITCH] != SCANLINE_FX_OFF)
+    {
+        glitch_row(row, n);
+    }
+    if (info->level[SCANLINE_FX_PALETTE] != SCANLINE_FX_OFF && s_palette_offset != 0)
+    {
+        uint32_t add = s_palette_add;
+        FOR_EACH_PIXEL_WORD(row, n, palette_rotate4(pixels, add));
+    }
+    if (info->level[SCANLINE_FX_FADE] == SCANLINE_FX_FULL && s_fade_level < 8)
+    {
+        pixel_kernels_fade332(row, row, n, s_fade_level * (PIXEL_KERNELS_ALPHA_MAX / 8));
+    }
+    else if (info->level[SCANLINE_FX_FADE] == SCANLINE_FX_DEGRADED && s_fade_level < 7)
+    {
+        // Nearest of 1/2, 1/4 and black
+        if (s_fade_level >= 3)
+            FOR_EACH_PIXEL_WORD(row, n, half4(pixels));
+        else if (s_fade_level >= 1)
+            FOR_EACH_PIXEL_WORD(row, n, quarter4(pixels));
+        else
+            memset(row, 0x00, n);
+    }
+    if (info->level[SCANLINE_FX_DARKEN] != SCANLINE_FX_OFF && (y & 1))
+    {
+        FOR_EACH_PIXEL_WORD(row, n, half4(pixels));
+    }
+
+    info->fx_us += time_us_32() - t0;
+}
+
+void scanline_fx_end_frame(uint32_t compose_us)
+{
+    scanline_fx_info_t *info = g_scanline_fx_info;
+    info->frames++;
+    if (s_budget_us == 0)
+    {
+        return;
+    }
+
+    if (compose_us > s_budget_us)
+    {
+        info->over_budget++;
+        s_calm_frames = 0;
+
+        // Step down the running effect with the highest declared cost
+        int worst = -1;
+        for (int i = 0; i < SCANLINE_FX_COUNT; i++)
+        {
+            if (info->level[i] != SCANLINE_FX_OFF &&
+                (worst < 0 || effect_cost(i, info->level[i]) > effect_cost(worst, info->level[worst])))
+            {
+                worst = i;
+            }
+        }
+        if (worst >= 0)
+        {
+            info->level[worst] = level_down(worst, info->level[worst]);
+            info->shed++;
+        }
+        return;
+    }
+
+    // The cheapest step back towards what was requested, if the frame had room for it
+    int best = -1;
+    uint32_t best_extra_us = 0;
+    for (int i = 0; i < SCANLINE_FX_COUNT; i++)
+    {
+        if (!info->enabled[i] || info->level[i] == SCANLINE_FX_FULL)
+        {
+            continue;
+        }
+        scanline_fx_level_t up = level_up(i, info->level[i]);
+        uint32_t extra_us = cycles_to_us(effect_cost(i, up) - effect_cost(i, info->level[i]));
+        if (best < 0 || extra_us < best_extra_us)
+        {
+            best = i;
+            best_extra_us = extra_us;
+        }
+    }
+    if (best < 0 || compose_us + best_extra_us > s_budget_us - s_budget_us / 8)
+    {
+        s_calm_frames = 0;
+        return;
+    }
+    if (++s_calm_frames >= SCANLINE_FX_RESTORE_FRAMES)
+    {
+        info->level[best] = level_up(best, info->level[best]);
+        info->restored++;
+        s_calm_frames = 0;
+    }
+}
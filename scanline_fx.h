@@ -0,0 +1,76 @@
+#ifndef __SCANLINE_FX_H__
+#define __SCANLINE_FX_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define SCANLINE_FX_RESTORE_FRAMES 30 // Frames with headroom before a shed effect steps back up
+
+typedef enum
+{
+    SCANLINE_FX_GLITCH = 0, // A random span shifted sideways over a block of rows
+    SCANLINE_FX_PALETTE,    // Palette rotation: the RGB332 index of every non-black pixel + offset
+    SCANLINE_FX_FADE,       // Every channel scaled by fade_level / 8 (degraded: nearest of 1, 1/2, 1/4, 0)
+    SCANLINE_FX_DARKEN,     // Every other row at half brightness
+    SCANLINE_FX_COUNT
+} scanline_fx_id_t;
+
+typedef enum
+{
+    SCANLINE_FX_OFF = 0,
+    SCANLINE_FX_DEGRADED,
+    SCANLINE_FX_FULL
+} scanline_fx_level_t;
+
+typedef struct
+{
+    uint16_t width;                    // Row bytes the effects run over
+    uint16_t height;                   // Rows per frame
+    bool enabled[SCANLINE_FX_COUNT];   // Requested effects
+
+    // Effect parameters, free to change between frames
+    uint16_t glitch_chance;     // Chance per row that a glitch block starts, in 1/65536
+    uint16_t glitch_max_length; // Widest shifted span
+    uint8_t glitch_max_offset;  // Largest shift either way
+    uint8_t glitch_max_rows;    // Tallest glitch block
+    uint8_t palette_step;       // Added to the palette offset every frame
+    uint8_t fade_level;         // 0 (black) .. 8 (unchanged)
+
+    // What runs: the requested effects minus what the budget shed
+    scanline_fx_level_t level[SCANLINE_FX_COUNT];
+
+    // Statistics since the last scanline_fx_reset_stats()
+    uint32_t frames;
+    uint32_t fx_us;       // Time spent in the effects
+    uint32_t over_budget; // Frames whose compose time exceeded the budget
+    uint32_t shed;        // Steps down (full -> degraded -> off)
+    uint32_t restored;    // Steps back up
+} scanline_fx_info_t;
+
+// Runs the enabled effects at full level. Declared costs (CPU cycles per 4
+// pixels, see scanline_fx_cost_us) are converted to time at clk_sys.
+void scanline_fx_init(scanline_fx_info_t *fx_info);
+scanline_fx_info_t *scanline_fx_get_info(void);
+
+// Predicted time one frame of the effects costs at the given levels
+uint32_t scanline_fx_cost_us(const scanline_fx_level_t *level);
+
+// Starts a frame that must be composed within budget_us: advances the palette
+// offset and freezes the effects' parameters for the frame.
+void scanline_fx_begin_frame(uint32_t budget_us);
+
+// Applies the running effects to row y (0..height-1) of the frame, in place.
+// Any alignment works; whole words are processed 4 pixels at a time.
+void scanline_fx_apply_row(int y, uint8_t *row);
+
+// Feeds back the frame's measured compose time (effects included). Over budget
+// the effect with the highest declared cost steps down one level; after
+// SCANLINE_FX_RESTORE_FRAMES frames with room for it, the cheapest shed step
+// comes back.
+void scanline_fx_end_frame(uint32_t compose_us);
+
+void scanline_fx_reset_stats(void);
+
+#endif // __SCANLINE_FX_H__
@@ -0,0 +1,18 @@
+// Host stand-in for the Pico SDK clocks API
+#ifndef __TEST_STUB_HARDWARE_CLOCKS_H__
+#define __TEST_STUB_HARDWARE_CLOCKS_H__
+
+#include <stdint.h>
+
+enum
+{
+    clk_sys = 5
+};
+
+static inline uint32_t clock_get_hz(int clock)
+{
+    (void)clock;
+    return 150000000;
+}
+
+#endif // __TEST_STUB_HARDWARE_CLOCKS_H__
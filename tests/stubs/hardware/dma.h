@@ -0,0 +1,69 @@
+// Host stand-in for the Pico SDK DMA API: no channel is ever free, and the
+// test counts how often one was asked for (test_dma_claims)
+#ifndef __TEST_STUB_HARDWARE_DMA_H__
+#define __TEST_STUB_HARDWARE_DMA_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+extern int test_dma_claims;
+
+typedef struct
+{
+    int unused;
+} dma_channel_config;
+
+enum
+{
+    DMA_SIZE_32 = 2
+};
+
+static inline int dma_claim_unused_channel(bool required)
+{
+    (void)required;
+    test_dma_claims++;
+    return -1;
+}
+
+static inline void dma_channel_wait_for_finish_blocking(int channel)
+{
+    (void)channel;
+}
+
+static inline dma_channel_config dma_channel_get_default_config(int channel)
+{
+    (void)channel;
+    dma_channel_config c = {0};
+    return c;
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, int size)
+{
+    (void)c;
+    (void)size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+static inline void dma_channel_configure(int channel, dma_channel_config *c, void *write_addr, const void *read_addr,
+                                         size_t count, bool trigger)
+{
+    (void)channel;
+    (void)c;
+    (void)write_addr;
+    (void)read_addr;
+    (void)count;
+    (void)trigger;
+}
+
+#endif // __TEST_STUB_HARDWARE_DMA_H__
@@ -0,0 +1,21 @@
+// Host stand-in for the Pico SDK header, just what the modules under test use
+#ifndef __TEST_STUB_PICO_STDLIB_H__
+#define __TEST_STUB_PICO_STDLIB_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t time_us_32(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)(t.tv_sec * 1000000u + t.tv_nsec / 1000);
+}
+
+static inline void tight_loop_contents(void)
+{
+}
+
+#endif // __TEST_STUB_PICO_STDLIB_H__
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ff.h"
+#include "diskio.h"
+
+// Counts the disk_read calls FatFS makes to re-open and read a set of frame files, as the player
+// does, on a RAM disk. Built once per FF_PATH_CACHE / FF_FAT_CACHE setting. Given the paths of
+// other builds, it runs them and fails unless it made fewer disk_read calls than each of them.
+
+#define DISK_SECTORS (16 * 1024 * 1024 / 512)
+#define FRAME_FILES 60
+#define FRAME_FILE_BYTES 6000
+#define PASSES 3
+
+static BYTE *s_disk;
+static FATFS s_fs;
+static unsigned s_disk_reads;
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return pdrv == 0 ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    return pdrv == 0 ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv != 0 || sector + count > DISK_SECTORS)
+        return RES_PARERR;
+    memcpy(buff, &s_disk[sector * 512], (size_t)count * 512);
+    s_disk_reads++;
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv != 0 || sector + count > DISK_SECTORS)
+        return RES_PARERR;
+    memcpy(&s_disk[sector * 512], buff, (size_t)count * 512);
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    if (pdrv != 0)
+        return RES_PARERR;
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(LBA_t *)buff = DISK_SECTORS;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD *)buff = 1;
+        return RES_OK;
+    }
+    return RES_PARERR;
+}
+
+DWORD get_fattime(void)
+{
+    return ((DWORD)(2024 - 1980) << 25) | (1 << 21) | (1 << 16);
+}
+
+static BYTE pattern(int file, UINT offset)
+{
+    return (BYTE)(file * 31 + offset * 7 + (offset >> 8));
+}
+
+// One-sector clusters, with the files appended to in turn a sector at a time, so every file's
+// cluster chain is interleaved with the others and spans several FAT sectors
+static FRESULT make_volume(void)
+{
+    static BYTE work[FF_MAX_SS * 4];
+    static BYTE data[FRAME_FILE_BYTES];
+    MKFS_PARM opt = {FM_FAT, 0, 0, 0, 512};
+    FRESULT fr = f_mkfs("", &opt, work, sizeof(work));
+    if (fr == FR_OK)
+        fr = f_mount(&s_fs, "", 1);
+    if (fr == FR_OK)
+        fr = f_mkdir("/frames");
+    for (UINT offset = 0; fr == FR_OK && offset < FRAME_FILE_BYTES; offset += 512)
+    {
+        UINT len = FRAME_FILE_BYTES - offset < 512 ? FRAME_FILE_BYTES - offset : 512;
+        for (int file = 0; fr == FR_OK && file < FRAME_FILES; file++)
+        {
+            char path[32];
+            FIL fil;
+            UINT written;
+            snprintf(path, sizeof(path), "/frames/frame-%d.bin", file);
+            for (UINT i = 0; i < len; i++)
+                data[i] = pattern(file, offset + i);
+            fr = f_open(&fil, path, FA_WRITE | FA_OPEN_APPEND);
+            if (fr == FR_OK)
+                fr = f_write(&fil, data, len, &written);
+            if (fr == FR_OK)
+                fr = f_close(&fil);
+        }
+    }
+    if (fr == FR_OK)
+        fr = f_unmount("");
+    return fr;
+}
+
+// Re-opens and reads every file PASSES times from a fresh mount, so every cache starts cold
+static FRESULT play(int *bad_bytes)
+{
+    static BYTE data[FRAME_FILE_BYTES];
+    FRESULT fr = f_mount(&s_fs, "", 1);
+    for (int pass = 0; fr == FR_OK && pass < PASSES; pass++)
+    {
+        for (int file = 0; fr == FR_OK && file < FRAME_FILES; file++)
+        {
+            char path[32];
+            FIL fil;
+            UINT read;
+            snprintf(path, sizeof(path), "/frames/frame-%d.bin", file);
+            fr = f_open(&fil, path, FA_READ);
+            if (fr != FR_OK)
+                break;
+            fr = f_read(&fil, data, sizeof(data), &read);
+            f_close(&fil);
+            for (UINT i = 0; i < sizeof(data); i++)
+            {
+                *bad_bytes += i >= read || data[i] != pattern(file, i);
+            }
+        }
+    }
+    return fr;
+}
+
+// Runs another build of this test and returns its count, or 0 if it failed
+static unsigned reads_of(const char *exe)
+{
+    FILE *p = popen(exe, "r");
+    if (p == NULL)
+        return 0;
+    unsigned reads = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), p) != NULL)
+    {
+        sscanf(line, "disk_read calls: %u", &reads);
+    }
+    return pclose(p) == 0 ? reads : 0;
+}
+
+int main(int argc, char **argv)
+{
+    s_disk = calloc(DISK_SECTORS, 512);
+    FRESULT fr = make_volume();
+    if (fr != FR_OK)
+    {
+        printf("FAIL setup: FRESULT %d\n", fr);
+        return 1;
+    }
+
+    int bad_bytes = 0;
+    s_disk_reads = 0;
+    fr = play(&bad_bytes);
+    if (fr != FR_OK || bad_bytes)
+    {
+        printf("FAIL play: FRESULT %d, %d bytes wrong\n", fr, bad_bytes);
+        return 1;
+    }
+    printf("FF_PATH_CACHE %d, FF_FAT_CACHE %d: %d opens and reads of %d-byte files\n", FF_PATH_CACHE, FF_FAT_CACHE,
+           PASSES * FRAME_FILES, FRAME_FILE_BYTES);
+    printf("disk_read calls: %u\n", s_disk_reads);
+
+    int failures = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        unsigned other = reads_of(argv[i]);
+        if (other == 0)
+        {
+            printf("FAIL %s didn't run\n", argv[i]);
+            failures++;
+        }
+        else if (s_disk_reads >= other)
+        {
+            printf("FAIL %u disk_read calls, %s made %u\n", s_disk_reads, argv[i], other);
+            failures++;
+        }
+        else
+        {
+            printf("%u fewer than %s (%u, -%.1f%%)\n", other - s_disk_reads, argv[i], other,
+                   (other - s_disk_reads) * 100.0 / other);
+        }
+    }
+    return failures != 0;
+}
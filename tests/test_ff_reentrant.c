@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ff.h"
+#include "diskio.h"
+
+// Stress test for the re-entrant FatFS build on POSIX threads (ffsystem.c OS_TYPE 6): reader threads
+// re-open and verify frame files through the path and FAT caches while a writer creates, rewrites,
+// syncs and deletes its own files on the same volume.
+
+#define DISK_SECTORS (16 * 1024 * 1024 / 512)
+#define FRAME_FILES 32
+#define FRAME_FILE_BYTES 6000
+#define READERS 3
+#define READER_OPENS 2000
+#define WRITER_ROUNDS 400
+
+static BYTE *s_disk;
+static pthread_mutex_t s_disk_lock = PTHREAD_MUTEX_INITIALIZER; // FatFS may call the driver from any thread
+static FATFS s_fs;
+static int s_failures;
+static pthread_mutex_t s_failure_lock = PTHREAD_MUTEX_INITIALIZER;
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return pdrv == 0 ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    return pdrv == 0 ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv != 0 || sector + count > DISK_SECTORS)
+        return RES_PARERR;
+    pthread_mutex_lock(&s_disk_lock);
+    memcpy(buff, &s_disk[sector * 512], (size_t)count * 512);
+    pthread_mutex_unlock(&s_disk_lock);
+    sched_yield(); // Like a card read, give the other threads a chance to find the volume locked
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv != 0 || sector + count > DISK_SECTORS)
+        return RES_PARERR;
+    pthread_mutex_lock(&s_disk_lock);
+    memcpy(&s_disk[sector * 512], buff, (size_t)count * 512);
+    pthread_mutex_unlock(&s_disk_lock);
+    sched_yield();
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    if (pdrv != 0)
+        return RES_PARERR;
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(LBA_t *)buff = DISK_SECTORS;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD *)buff = 1;
+        return RES_OK;
+    }
+    return RES_PARERR;
+}
+
+DWORD get_fattime(void)
+{
+    return ((DWORD)(2024 - 1980) << 25) | (1 << 21) | (1 << 16);
+}
+
+static void fail(const char *what, int index, FRESULT fr)
+{
+    pthread_mutex_lock(&s_failure_lock);
+    printf("FAIL %s %d: FRESULT %d\n", what, index, fr);
+    s_failures++;
+    pthread_mutex_unlock(&s_failure_lock);
+}
+
+static BYTE pattern(int file, UINT offset)
+{
+    return (BYTE)(file * 31 + offset * 7 + (offset >> 8));
+}
+
+static FRESULT write_file(const char *path, int file)
+{
+    static BYTE data[FRAME_FILE_BYTES]; // Only ever used by one thread at a time (setup, then the writer)
+    FIL fil;
+    UINT written;
+    for (UINT i = 0; i < FRAME_FILE_BYTES; i++)
+        data[i] = pattern(file, i);
+    FRESULT fr = f_open(&fil, path, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK)
+        return fr;
+    fr = f_write(&fil, data, FRAME_FILE_BYTES / 2, &written);
+    if (fr == FR_OK)
+        fr = f_sync(&fil); // Flushes the path cache with readers active
+    if (fr == FR_OK)
+        fr = f_write(&fil, data + FRAME_FILE_BYTES / 2, FRAME_FILE_BYTES - FRAME_FILE_BYTES / 2, &written);
+    FRESULT close_fr = f_close(&fil);
+    return fr != FR_OK ? fr : close_fr;
+}
+
+static void *reader(void *arg)
+{
+    unsigned seed = (unsigned)(size_t)arg;
+    static __thread BYTE data[FRAME_FILE_BYTES];
+    for (int i = 0; i < READER_OPENS; i++)
+    {
+        int file = rand_r(&seed) % FRAME_FILES;
+        char path[32];
+        snprintf(path, sizeof(path), "/frames/frame-%d.bin", file);
+        FIL fil;
+        UINT read;
+        FRESULT fr = f_open(&fil, path, FA_READ);
+        if (fr != FR_OK)
+        {
+            fail("open", file, fr);
+            continue;
+        }
+        fr = f_read(&fil, data, sizeof(data), &read);
+        f_close(&fil);
+        if (fr != FR_OK || read != FRAME_FILE_BYTES)
+        {
+            fail("read", file, fr);
+            continue;
+        }
+        for (UINT k = 0; k < read; k++)
+        {
+            if (data[k] != pattern(file, k))
+            {
+                fail("verify", file, FR_OK);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < WRITER_ROUNDS; i++)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), "/scratch-%d.bin", i % 4);
+        FRESULT fr = write_file(path, 1000 + i);
+        if (fr != FR_OK)
+            fail("write", i, fr);
+        if (i % 4 == 3)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                snprintf(path, sizeof(path), "/scratch-%d.bin", k);
+                fr = f_unlink(path);
+                if (fr != FR_OK)
+                    fail("unlink", k, fr);
+            }
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    static BYTE work[FF_MAX_SS * 4];
+    s_disk = calloc(DISK_SECTORS, 512);
+    MKFS_PARM opt = {FM_FAT, 0, 0, 0, 0};
+    FRESULT fr = f_mkfs("", &opt, work, sizeof(work));
+    if (fr == FR_OK)
+        fr = f_mount(&s_fs, "", 1);
+    if (fr == FR_OK)
+        fr = f_mkdir("/frames");
+    for (int file = 0; fr == FR_OK && file < FRAME_FILES; file++)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), "/frames/frame-%d.bin", file);
+        fr = write_file(path, file);
+    }
+    if (fr != FR_OK)
+    {
+        printf("FAIL setup: FRESULT %d\n", fr);
+        return 1;
+    }
+
+    pthread_t threads[READERS + 1];
+    for (int i = 0; i < READERS; i++)
+        pthread_create(&threads[i], NULL, reader, (void *)(size_t)(i + 1));
+    pthread_create(&threads[READERS], NULL, writer, NULL);
+    for (int i = 0; i <= READERS; i++)
+        pthread_join(threads[i], NULL);
+
+    DWORD contended, timeouts;
+    ff_mutex_stats(0, &contended, &timeouts);
+    printf("ff_reentrant: %d reads, %d writes, %u contended, %u timed out: %s\n", READERS * READER_OPENS,
+           WRITER_ROUNDS, (unsigned)contended, (unsigned)timeouts, s_failures ? "FAILED" : "ok");
+    free(s_disk);
+    return s_failures != 0 || timeouts != 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_codec.h"
+
+#define MAX_WIDTH 466
+#define MAX_HEIGHT 466
+
+static uint8_t s_frame[MAX_WIDTH * MAX_HEIGHT];
+static uint8_t s_encoded[FRAME_CODEC_MAX_SIZE(MAX_WIDTH, MAX_HEIGHT)];
+static uint8_t s_row[MAX_WIDTH + 1];
+static int s_failures;
+
+// Rows mixing every token: short and long black runs, fills, literals
+static void make_frame(uint16_t width, uint16_t height, unsigned seed)
+{
+    srand(seed);
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t *row = &s_frame[y * width];
+        int x = 0;
+        while (x < width)
+        {
+            int kind = rand() % 4;
+            int run = kind == 3 ? rand() % 300 + 1 : rand() % 80 + 1;
+            uint8_t value = rand() % 255 + 1;
+            for (int i = 0; i < run && x < width; i++, x++)
+            {
+                row[x] = kind == 0 || kind == 3 ? 0x00 : kind == 1 ? value : (uint8_t)rand();
+            }
+        }
+    }
+}
+
+static void check_round_trip(const char *label, uint16_t width, uint16_t height)
+{
+    size_t size = frame_codec_encode(s_frame, width, height, s_encoded, sizeof(s_encoded));
+    if (size == 0 || size > FRAME_CODEC_MAX_SIZE(width, height))
+    {
+        printf("FAIL %s %ux%u: encoded size %zu\n", label, width, height, size);
+        s_failures++;
+        return;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        s_row[width] = 0xA5; // Guard byte: decoding must stop at width
+        frame_codec_decode_row(s_encoded, width, y, s_row);
+        if (memcmp(s_row, &s_frame[y * width], width) != 0 || s_row[width] != 0xA5)
+        {
+            printf("FAIL %s %ux%u: row %d differs\n", label, width, height, y);
+            s_failures++;
+            return;
+        }
+    }
+    // Too small a buffer is refused rather than overrun
+    if (frame_codec_encode(s_frame, width, height, s_encoded, size - 1) != 0)
+    {
+        printf("FAIL %s %ux%u: encoded into %zu bytes\n", label, width, height, size - 1);
+        s_failures++;
+    }
+}
+
+int main(void)
+{
+    static const uint16_t sizes[][2] = {{140, 140}, {466, 466}, {1, 1}, {65, 3}, {333, 7}};
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        uint16_t width = sizes[i][0];
+        uint16_t height = sizes[i][1];
+        for (unsigned seed = 1; seed <= 20; seed++)
+        {
+            make_frame(width, height, seed);
+            check_round_trip("mixed", width, height);
+        }
+        memset(s_frame, 0x00, (size_t)width * height);
+        check_round_trip("black", width, height);
+        memset(s_frame, 0xFF, (size_t)width * height);
+        check_round_trip("fill", width, height);
+        for (size_t p = 0; p < (size_t)width * height; p++)
+        {
+            s_frame[p] = (uint8_t)(p * 7 + 1) | 1; // No runs at all: literals only
+        }
+        check_round_trip("literal", width, height);
+    }
+
+    printf("frame_codec: %s\n", s_failures ? "FAILED" : "ok");
+    return s_failures != 0;
+}
@@ -0,0 +1,124 @@
+// Checks the panel_mask chord and band tables against the circle equation
+#include <stdio.h>
+#include <stdlib.h>
+#include "panel_mask.h"
+
+static int s_failures;
+
+#define CHECK(cond, ...)          \
+    do                            \
+    {                             \
+        if (!(cond))              \
+        {                         \
+            printf(__VA_ARGS__);  \
+            printf("\n");         \
+            s_failures++;         \
+        }                         \
+    } while (0)
+
+// Pixel centre inside the inscribed disc, in doubled coordinates
+static int visible(const panel_mask_info_t *info, int x, int y)
+{
+    int64_t d = info->width < info->height ? info->width : info->height;
+    int64_t dx = 2 * x + 1 - info->width;
+    int64_t dy = 2 * y + 1 - info->height;
+    return dx * dx + dy * dy <= d * d;
+}
+
+// The chord is exactly the visible run: its ends are in, the pixels beyond them out
+static void check_row(const panel_mask_info_t *info, int y, const char *what)
+{
+    uint16_t x_start, x_end;
+    panel_mask_row_chord(y, &x_start, &x_end);
+    CHECK(x_start <= x_end && x_end <= info->width, "%ux%u %s row %d: chord [%u, %u) out of the panel",
+          info->width, info->height, what, y, x_start, x_end);
+    if (x_start < x_end)
+    {
+        CHECK(visible(info, x_start, y) && visible(info, x_end - 1, y), "%ux%u %s row %d: chord [%u, %u) ends outside the disc",
+              info->width, info->height, what, y, x_start, x_end);
+    }
+    CHECK(x_start == 0 || !visible(info, x_start - 1, y), "%ux%u %s row %d: pixel %u left of the chord is visible",
+          info->width, info->height, what, y, x_start - 1);
+    CHECK(x_end >= info->width || !visible(info, x_end, y), "%ux%u %s row %d: pixel %u right of the chord is visible",
+          info->width, info->height, what, y, x_end);
+}
+
+static void check_panel(uint16_t width, uint16_t height, uint16_t window_cost)
+{
+    panel_mask_info_t info = {.width = width, .height = height, .window_cost = window_cost};
+    panel_mask_init(&info);
+
+    // Edge rows and the centre first, so a failure names them
+    check_row(&info, 0, "top");
+    check_row(&info, height - 1, "bottom");
+    check_row(&info, height / 2, "centre");
+    check_row(&info, (height - 1) / 2, "centre");
+
+    // Centre row of a square panel is the full diameter and the top row a short centred chord (tiny panels have none)
+    uint16_t x_start, x_end;
+    if (width == height && width >= 16)
+    {
+        panel_mask_row_chord(height / 2, &x_start, &x_end);
+        CHECK(x_start == 0 && x_end == width, "%ux%u centre row: chord [%u, %u), want [0, %u)",
+              width, height, x_start, x_end, width);
+        panel_mask_row_chord(0, &x_start, &x_end);
+        CHECK(x_end - x_start < width / 4 && x_start + x_end == width, "%ux%u top row: chord [%u, %u) not a short centred run",
+              width, height, x_start, x_end);
+    }
+
+    uint32_t visible_pixels = 0;
+    uint32_t sent_pixels = 0;
+    int band_index = 0;
+    const panel_mask_band_t *band = NULL;
+    for (int y = 0; y < height; y++)
+    {
+        check_row(&info, y, "");
+        for (int x = 0; x < width; x++)
+        {
+            visible_pixels += visible(&info, x, y);
+        }
+
+        // Bands tile the rows in order and each one covers its rows' chords
+        const panel_mask_band_t *row_band = panel_mask_band_of_row(y);
+        if (row_band != band)
+        {
+            CHECK(row_band->y_start == y, "%ux%u row %d: band starts at %u", width, height, y, row_band->y_start);
+            CHECK(band == NULL || band->y_end == y, "%ux%u row %d: previous band ends at %u", width, height, y, band->y_end);
+            CHECK(row_band->x_start < row_band->x_end, "%ux%u row %d: empty band window", width, height, y);
+            band = row_band;
+            band_index++;
+            sent_pixels += (uint32_t)(band->y_end - band->y_start) * (band->x_end - band->x_start);
+        }
+        panel_mask_row_chord(y, &x_start, &x_end);
+        CHECK(x_start == x_end || (band->x_start <= x_start && x_end <= band->x_end),
+              "%ux%u row %d: chord [%u, %u) outside its band [%u, %u)", width, height, y, x_start, x_end, band->x_start, band->x_end);
+    }
+    CHECK(band != NULL && band->y_end == height, "%ux%u: last band doesn't end at the bottom row", width, height);
+    CHECK(band_index == info.band_count, "%ux%u: %d bands walked, %u counted", width, height, band_index, info.band_count);
+    CHECK(visible_pixels == info.visible_pixels, "%ux%u: %u pixels visible, table says %u",
+          width, height, visible_pixels, info.visible_pixels);
+    CHECK(sent_pixels == info.sent_pixels, "%ux%u: bands cover %u pixels, table says %u", width, height, sent_pixels, info.sent_pixels);
+
+    printf("%ux%u cost %u: %u bands, %.1f%% of the panel sent, %.1f%% visible\n", width, height, window_cost,
+           info.band_count, info.sent_pixels * 100.0 / (width * height), info.visible_pixels * 100.0 / (width * height));
+}
+
+int main(void)
+{
+    check_panel(466, 466, 24);  // The CO5300 panel at the default PANEL_MASK_WINDOW_COST
+    check_panel(466, 466, 0);   // Merges only rows that add no waste
+    check_panel(466, 466, 60000); // Everything merges into one band
+    check_panel(465, 465, 24);
+    check_panel(480, 480, 24);
+    check_panel(480, 320, 24);  // Disc inscribed in the shorter side
+    check_panel(1, 1, 24);
+    check_panel(2, 2, 24);
+
+    if (s_failures)
+    {
+        printf("%d failures\n", s_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+// Runs bsp_co5300_repeat.pio on a small PIO state machine model and checks the
+// bytes clocked out on the SPI pins: every pixel N times, MSB first, sampled on
+// the rising SCLK edge (mode 0), with SCLK low while the state machine stalls.
+//
+// Only the instructions the program uses are modelled (pull, mov, out pins, nop,
+// jmp, jmp x--, side-set and delays); anything else in the source fails the test.
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INSTRUCTIONS 32
+#define MAX_LABELS 8
+#define FIFO_SIZE 4096
+#define IDLE_CYCLES 40 // Stalled cycles that end a run
+
+typedef enum { OP_PULL, OP_MOV, OP_OUT_PINS, OP_NOP, OP_JMP, OP_JMP_X_DEC } op_t;
+typedef enum { REG_X, REG_Y, REG_ISR, REG_OSR } reg_t;
+
+typedef struct
+{
+    op_t op;
+    reg_t dst, src;   // mov
+    int bits;         // out
+    char target[32];  // jmp label
+    int jmp_pc;
+    int side;
+    int delay;
+} instruction_t;
+
+static instruction_t s_prog[MAX_INSTRUCTIONS];
+static int s_prog_len;
+static int s_wrap_target;
+static int s_wrap = -1;
+static char s_label_name[MAX_LABELS][32];
+static int s_label_pc[MAX_LABELS];
+static int s_label_count;
+
+static int parse_reg(const char *name, reg_t *reg)
+{
+    static const char *const names[] = {"x", "y", "isr", "osr"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            *reg = (reg_t)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// One instruction: "<op> [args] side <n> [<delay>]"
+static int parse_instruction(char *text, instruction_t *ins)
+{
+    memset(ins, 0, sizeof(*ins));
+    char *side = strstr(text, " side ");
+    if (side == NULL)
+        return 0;
+    *side = '\0';
+    ins->side = atoi(side + 6);
+    char *delay = strchr(side + 6, '[');
+    if (delay != NULL)
+        ins->delay = atoi(delay + 1);
+
+    for (char *p = text; *p; p++)
+    {
+        if (*p == ',')
+            *p = ' ';
+    }
+    char words[3][32] = {{0}};
+    int n = sscanf(text, "%31s %31s %31s", words[0], words[1], words[2]);
+    if (n == 1 && strcmp(words[0], "pull") == 0)
+        ins->op = OP_PULL;
+    else if (n == 1 && strcmp(words[0], "nop") == 0)
+        ins->op = OP_NOP;
+    else if (n == 3 && strcmp(words[0], "mov") == 0 && parse_reg(words[1], &ins->dst) && parse_reg(words[2], &ins->src))
+        ins->op = OP_MOV;
+    else if (n == 3 && strcmp(words[0], "out") == 0 && strcmp(words[1], "pins") == 0)
+    {
+        ins->op = OP_OUT_PINS;
+        ins->bits = atoi(words[2]);
+    }
+    else if (n == 3 && strcmp(words[0], "jmp") == 0 && strcmp(words[1], "x--") == 0)
+    {
+        ins->op = OP_JMP_X_DEC;
+        strcpy(ins->target, words[2]);
+    }
+    else if (n == 2 && strcmp(words[0], "jmp") == 0)
+    {
+        ins->op = OP_JMP;
+        strcpy(ins->target, words[1]);
+    }
+    else
+        return 0;
+    return 1;
+}
+
+static int load_program(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        printf("can't open %s\n", path);
+        return 0;
+    }
+    char line[256];
+    int side_set_bits = 0;
+    while (fgets(line, sizeof(line), f) != NULL && strncmp(line, "% c-sdk", 7) != 0)
+    {
+        char *comment = strchr(line, ';');
+        if (comment != NULL)
+            *comment = '\0';
+        char *text = line;
+        while (isspace((unsigned char)*text))
+            text++;
+        char *end = text + strlen(text);
+        while (end > text && isspace((unsigned char)end[-1]))
+            *--end = '\0';
+        if (*text == '\0' || strncmp(text, ".program", 8) == 0)
+            continue;
+        if (strncmp(text, ".side_set", 9) == 0)
+            side_set_bits = atoi(text + 9);
+        else if (strcmp(text, ".wrap_target") == 0)
+            s_wrap_target = s_prog_len;
+        else if (strcmp(text, ".wrap") == 0)
+            s_wrap = s_prog_len - 1;
+        else if (end[-1] == ':')
+        {
+            end[-1] = '\0';
+            strcpy(s_label_name[s_label_count], text);
+            s_label_pc[s_label_count++] = s_prog_len;
+        }
+        else if (s_prog_len == MAX_INSTRUCTIONS || !parse_instruction(text, &s_prog[s_prog_len++]))
+        {
+            printf("unsupported line: %s\n", text);
+            fclose(f);
+            return 0;
+        }
+    }
+    fclose(f);
+
+    for (int i = 0; i < s_prog_len; i++)
+    {
+        if (s_prog[i].op != OP_JMP && s_prog[i].op != OP_JMP_X_DEC)
+            continue;
+        s_prog[i].jmp_pc = -1;
+        for (int l = 0; l < s_label_count; l++)
+        {
+            if (strcmp(s_label_name[l], s_prog[i].target) == 0)
+                s_prog[i].jmp_pc = s_label_pc[l];
+        }
+        if (s_prog[i].jmp_pc < 0)
+        {
+            printf("unknown label %s\n", s_prog[i].target);
+            return 0;
+        }
+    }
+    if (side_set_bits != 1 || s_wrap < 0)
+    {
+        printf("expected .side_set 1 and a .wrap\n");
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct
+{
+    uint32_t reg[4]; // x, y, isr, osr
+    int pc;
+    int delay;
+    int data_pin;
+    int clk_pin;
+    uint32_t fifo[FIFO_SIZE];
+    int fifo_head, fifo_count;
+} state_machine_t;
+
+// Runs one instruction. Returns 0 if it stalled (the side-set still applies).
+static int step(state_machine_t *sm, const instruction_t *ins, int exec)
+{
+    int jumped = 0;
+    sm->clk_pin = ins->side;
+    switch (ins->op)
+    {
+    case OP_PULL:
+        if (sm->fifo_count == 0)
+            return 0;
+        sm->reg[REG_OSR] = sm->fifo[sm->fifo_head];
+        sm->fifo_head = (sm->fifo_head + 1) % FIFO_SIZE;
+        sm->fifo_count--;
+        break;
+    case OP_MOV:
+        sm->reg[ins->dst] = sm->reg[ins->src];
+        break;
+    case OP_OUT_PINS: // Shift left: MSB first
+        sm->data_pin = sm->reg[REG_OSR] >> (32 - ins->bits) & 1;
+        sm->reg[REG_OSR] <<= ins->bits;
+        break;
+    case OP_NOP:
+        break;
+    case OP_JMP_X_DEC:
+        if (sm->reg[REG_X]-- != 0)
+        {
+            sm->pc = ins->jmp_pc;
+            jumped = 1;
+        }
+        break;
+    case OP_JMP:
+        sm->pc = ins->jmp_pc;
+        jumped = 1;
+        break;
+    }
+    if (!exec && !jumped)
+        sm->pc = sm->pc == s_wrap ? s_wrap_target : sm->pc + 1;
+    sm->delay = ins->delay;
+    return 1;
+}
+
+static void push(state_machine_t *sm, uint32_t word)
+{
+    sm->fifo[(sm->fifo_head + sm->fifo_count) % FIFO_SIZE] = word;
+    sm->fifo_count++;
+}
+
+// Sends pixels through the program at the given repeat; returns the bytes seen
+// on the pins, or -1 if SCLK wasn't low while stalled or a byte was cut short
+static int run(const uint8_t *pixels, int count, int repeat, uint8_t *out, int out_size, uint32_t *cycles)
+{
+    static state_machine_t sm;
+    memset(&sm, 0, sizeof(sm));
+
+    // co5300_repeat_set_count: put N - 1, exec pull and mov isr, osr, then start at the program
+    const instruction_t pull = {.op = OP_PULL};
+    const instruction_t mov_isr = {.op = OP_MOV, .dst = REG_ISR, .src = REG_OSR};
+    push(&sm, repeat - 1);
+    step(&sm, &pull, 1);
+    step(&sm, &mov_isr, 1);
+    sm.pc = 0;
+    sm.delay = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        push(&sm, pixels[i] * 0x01010101u); // 8-bit DMA writes fill every byte lane
+    }
+
+    int bits = 0;
+    int bytes = 0;
+    int idle = 0;
+    int prev_clk = 0;
+    uint32_t cycle = 0;
+    uint32_t last_busy = 0;
+    while (idle < IDLE_CYCLES)
+    {
+        if (sm.delay > 0)
+        {
+            sm.delay--;
+        }
+        else if (!step(&sm, &s_prog[sm.pc], 0))
+        {
+            idle++;
+            if (sm.clk_pin != 0)
+            {
+                printf("repeat %d: SCLK high while stalled\n", repeat);
+                return -1;
+            }
+        }
+        else
+        {
+            last_busy = cycle;
+        }
+
+        // Mode 0: the panel samples the data pin on the rising edge
+        if (sm.clk_pin == 1 && prev_clk == 0)
+        {
+            if (bytes == out_size)
+                return -1;
+            out[bytes] = (uint8_t)(out[bytes] << 1 | sm.data_pin);
+            if (++bits == 8)
+            {
+                bits = 0;
+                bytes++;
+            }
+        }
+        prev_clk = sm.clk_pin;
+        cycle++;
+    }
+    *cycles = last_busy + 1;
+    return bits == 0 ? bytes : -1;
+}
+
+int main(void)
+{
+    if (!load_program(PIO_SOURCE))
+        return 1;
+    printf("%d instructions, wrap %d..%d\n", s_prog_len, s_wrap_target, s_wrap);
+
+    static uint8_t pixels[64];
+    static uint8_t out[64 * 8];
+    int failures = 0;
+    srand(1);
+    for (int repeat = 1; repeat <= 8; repeat++)
+    {
+        uint32_t cycles = 0;
+        int count = 0;
+        for (int trial = 0; trial < 20; trial++)
+        {
+            count = 1 + rand() % 40;
+            for (int i = 0; i < count; i++)
+            {
+                pixels[i] = rand();
+            }
+            // Every bit set, none, and single bits at either end
+            static const uint8_t edges[] = {0x00, 0xFF, 0x80, 0x01};
+            memcpy(&pixels[count], edges, sizeof(edges));
+            count += sizeof(edges);
+
+            memset(out, 0, sizeof(out));
+            int sent = run(pixels, count, repeat, out, sizeof(out), &cycles);
+            int ok = sent == count * repeat;
+            for (int i = 0; ok && i < sent; i++)
+            {
+                ok = out[i] == pixels[i / repeat];
+            }
+            if (!ok)
+            {
+                printf("repeat %d trial %d: %d bytes out for %d pixels\n", repeat, trial, sent, count);
+                failures++;
+            }
+        }
+        printf("repeat %d: %.1f cycles per byte out\n", repeat, (double)cycles / (count * repeat));
+    }
+
+    if (failures)
+    {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
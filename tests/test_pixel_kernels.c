@@ -0,0 +1,184 @@
+// Checks the word-at-a-time pixel kernels against their per-pixel _ref versions.
+// Host builds have no __ARM_FEATURE_DSP, so this covers the portable SWAR paths
+// (the M33's UQADD8 is checked on the target by PIXEL_KERNELS_BENCH).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pixel_kernels.h"
+
+int test_dma_claims;
+
+static int s_failures;
+
+#define CHECK(cond, ...)          \
+    do                            \
+    {                             \
+        if (!(cond))              \
+        {                         \
+            printf(__VA_ARGS__);  \
+            printf("\n");         \
+            s_failures++;         \
+        }                         \
+    } while (0)
+
+static uint32_t s_seed = 1;
+
+static uint32_t random_word(void)
+{
+    s_seed = s_seed * 1664525 + 1013904223;
+    uint32_t hi = s_seed >> 16;
+    s_seed = s_seed * 1664525 + 1013904223;
+    return hi << 16 | s_seed >> 16;
+}
+
+// Runs every RGB332 kernel on one word of a and b (4 pixels, word-aligned) at every alpha
+static void check_words(uint32_t word_a, uint32_t word_b)
+{
+    uint32_t a[1] = {word_a};
+    uint32_t b[1] = {word_b};
+    uint32_t out[1], ref[1];
+    const uint8_t *pa = (const uint8_t *)a;
+    const uint8_t *pb = (const uint8_t *)b;
+
+    // Past PIXEL_KERNELS_ALPHA_MAX the weight is clamped
+    for (int alpha = 0; alpha <= PIXEL_KERNELS_ALPHA_MAX + 1; alpha++)
+    {
+        pixel_kernels_blend332((uint8_t *)out, pa, pb, 4, alpha);
+        pixel_kernels_blend332_ref((uint8_t *)ref, pa, pb, 4, alpha);
+        CHECK(out[0] == ref[0], "blend332 %08x %08x alpha %d: %08x, ref %08x", word_a, word_b, alpha, out[0], ref[0]);
+
+        pixel_kernels_fade332((uint8_t *)out, pa, 4, alpha);
+        pixel_kernels_fade332_ref((uint8_t *)ref, pa, 4, alpha);
+        CHECK(out[0] == ref[0], "fade332 %08x alpha %d: %08x, ref %08x", word_a, alpha, out[0], ref[0]);
+    }
+    pixel_kernels_add332((uint8_t *)out, pa, pb, 4);
+    pixel_kernels_add332_ref((uint8_t *)ref, pa, pb, 4);
+    CHECK(out[0] == ref[0], "add332 %08x %08x: %08x, ref %08x", word_a, word_b, out[0], ref[0]);
+}
+
+// RGB565 kernel on one pixel pair at every alpha
+static void check_565(uint16_t a, uint16_t b)
+{
+    for (int alpha = 0; alpha <= PIXEL_KERNELS_ALPHA_MAX + 1; alpha++)
+    {
+        uint16_t out, ref;
+        pixel_kernels_lerp565(&out, &a, &b, 1, alpha);
+        pixel_kernels_lerp565_ref(&ref, &a, &b, 1, alpha);
+        CHECK(out == ref, "lerp565 %04x %04x alpha %d: %04x, ref %04x", a, b, alpha, out, ref);
+    }
+}
+
+// Rows at every alignment and length, so heads, words and tails all run; dst aliasing a source too
+static void check_rows(void)
+{
+    static uint8_t a[96], b[96], out[96], ref[96];
+    for (int i = 0; i < 96; i++)
+    {
+        a[i] = random_word();
+        b[i] = random_word();
+    }
+    for (int off_a = 0; off_a < 4; off_a++)
+    {
+        for (int off_b = 0; off_b < 4; off_b++)
+        {
+            for (int off_dst = 0; off_dst < 4; off_dst++)
+            {
+                for (int n = 0; n <= 40; n++)
+                {
+                    pixel_kernels_blend332(&out[off_dst], &a[off_a], &b[off_b], n, 13);
+                    pixel_kernels_blend332_ref(&ref[off_dst], &a[off_a], &b[off_b], n, 13);
+                    CHECK(memcmp(&out[off_dst], &ref[off_dst], n) == 0, "blend332 offsets %d/%d/%d n %d", off_a, off_b, off_dst, n);
+
+                    pixel_kernels_add332(&out[off_dst], &a[off_a], &b[off_b], n);
+                    pixel_kernels_add332_ref(&ref[off_dst], &a[off_a], &b[off_b], n);
+                    CHECK(memcmp(&out[off_dst], &ref[off_dst], n) == 0, "add332 offsets %d/%d/%d n %d", off_a, off_b, off_dst, n);
+
+                    pixel_kernels_fade332(&out[off_dst], &a[off_a], n, 19);
+                    pixel_kernels_fade332_ref(&ref[off_dst], &a[off_a], n, 19);
+                    CHECK(memcmp(&out[off_dst], &ref[off_dst], n) == 0, "fade332 offsets %d/%d n %d", off_a, off_dst, n);
+                }
+            }
+
+            // In place, as clip_transition and scanline_fx call them
+            memcpy(out, a, sizeof(out));
+            pixel_kernels_blend332_ref(ref, a, &b[off_b], 40, 7);
+            pixel_kernels_blend332(out, out, &b[off_b], 40, 7);
+            CHECK(memcmp(out, ref, 40) == 0, "blend332 in place, b offset %d", off_b);
+        }
+    }
+}
+
+// The CPU path (no DMA channel on the host) at every alignment and length
+static void check_fill(void)
+{
+    static uint8_t buf[64];
+    for (int off = 0; off < 4; off++)
+    {
+        for (int n = 0; n <= 30; n++)
+        {
+            memset(buf, 1, sizeof(buf));
+            pixel_kernels_fill(&buf[off], 7, n);
+            pixel_kernels_fill_wait();
+            for (int i = 0; i < (int)sizeof(buf); i++)
+            {
+                CHECK(buf[i] == (i >= off && i < off + n ? 7 : 1), "fill offset %d n %d: byte %d is %d", off, n, i, buf[i]);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    // Every 0x00/0xFF lane pattern on either side: the lane ends are where a carry or borrow would leak
+    int words = 0;
+    for (int mask_a = 0; mask_a < 16; mask_a++)
+    {
+        for (int mask_b = 0; mask_b < 16; mask_b++)
+        {
+            uint32_t a = 0, b = 0;
+            for (int lane = 0; lane < 4; lane++)
+            {
+                a |= (mask_a >> lane & 1 ? 0xFFu : 0) << (8 * lane);
+                b |= (mask_b >> lane & 1 ? 0xFFu : 0) << (8 * lane);
+            }
+            check_words(a, b);
+            check_words(a, random_word()); // Edges against anything
+            check_words(random_word(), b);
+            words += 3;
+        }
+    }
+    for (int i = 0; i < 100000; i++)
+    {
+        check_words(random_word(), random_word());
+        words++;
+    }
+    printf("RGB332: %d word pairs\n", words);
+
+    static const uint16_t edges565[] = {0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F, 0x07FF, 0xF81F, 0xFFE0};
+    for (int i = 0; i < 8; i++)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            check_565(edges565[i], edges565[j]);
+        }
+    }
+    for (int i = 0; i < 100000; i++)
+    {
+        check_565(random_word(), random_word());
+    }
+
+    check_rows();
+
+    // The fill's DMA channel is claimed lazily, once, by the first fill
+    CHECK(test_dma_claims == 0, "a DMA channel was claimed before any fill");
+    check_fill();
+    CHECK(test_dma_claims == 1, "%d DMA claims, want 1", test_dma_claims);
+
+    if (s_failures)
+    {
+        printf("%d failures\n", s_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Checks the effects' word-at-a-time paths (palette rotation, half and quarter brightness)
+// against per-pixel references, for every RGB332 value at every row alignment and length.
+// Host builds have no __ARM_FEATURE_DSP, so the palette rotation runs its portable SWAR path.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scanline_fx.h"
+#include "pixel_kernels.h"
+
+int test_dma_claims;
+
+static int s_failures;
+
+#define CHECK(cond, ...)          \
+    do                            \
+    {                             \
+        if (!(cond))              \
+        {                         \
+            printf(__VA_ARGS__);  \
+            printf("\n");         \
+            s_failures++;         \
+        }                         \
+    } while (0)
+
+#define MAX_WIDTH 300 // Longer than 256, so a row holds every value
+#define GUARD 0xA5
+
+static uint8_t rotate_ref(uint8_t p, uint8_t offset)
+{
+    return p == 0 ? 0 : (uint8_t)(p + offset); // Black stays black
+}
+
+static uint8_t scale_ref(uint8_t p, int shift)
+{
+    int r = p >> 5, g = p >> 2 & 7, b = p & 3;
+    return (uint8_t)((r >> shift) << 5 | (g >> shift) << 2 | (b >> shift));
+}
+
+typedef enum
+{
+    OP_ROTATE,
+    OP_HALF,
+    OP_QUARTER,
+    OP_BLACK,
+    OP_FADE,
+    OP_NONE
+} op_t;
+
+static const char *const s_op_name[] = {"palette", "half", "quarter", "black", "fade", "none"};
+
+static uint8_t ref(op_t op, uint8_t p, int arg)
+{
+    uint8_t out;
+    switch (op)
+    {
+    case OP_ROTATE:
+        return rotate_ref(p, arg);
+    case OP_HALF:
+        return scale_ref(p, 1);
+    case OP_QUARTER:
+        return scale_ref(p, 2);
+    case OP_BLACK:
+        return 0;
+    case OP_FADE:
+        pixel_kernels_fade332_ref(&out, &p, 1, arg);
+        return out;
+    default:
+        return p;
+    }
+}
+
+// Runs one frame's row y through the effects at every start alignment and checks it against
+// `op`, and that no byte either side of the row was touched
+static void check_row(scanline_fx_info_t *info, int y, op_t op, int arg, const char *what)
+{
+    static uint8_t buf[MAX_WIDTH + 8];
+    static uint8_t expect[MAX_WIDTH];
+    for (int align = 0; align < 4; align++)
+    {
+        memset(buf, GUARD, sizeof(buf));
+        uint8_t *row = (uint8_t *)(((uintptr_t)&buf[4] & ~(uintptr_t)3) + align);
+        for (int i = 0; i < info->width; i++)
+        {
+            row[i] = (uint8_t)(i * 97 + align); // 97 is odd: any 256 pixels in a row hold every value
+            expect[i] = ref(op, row[i], arg);
+        }
+        scanline_fx_apply_row(y, row);
+
+        int bad = 0;
+        for (int i = 0; i < info->width; i++)
+        {
+            if (row[i] != expect[i] && bad++ == 0)
+            {
+                CHECK(0, "%s width %d alignment %d: pixel %d is %02x, want %02x", what, info->width, align, i,
+                      row[i], expect[i]);
+            }
+        }
+        for (uint8_t *p = buf; p < &buf[sizeof(buf)]; p++)
+        {
+            if ((p < row || p >= row + info->width) && *p != GUARD)
+            {
+                CHECK(0, "%s width %d alignment %d: byte %d outside the row written", what, info->width, align,
+                      (int)(p - row));
+                break;
+            }
+        }
+    }
+}
+
+// A fresh instance with only `effect` on at `level`; the palette offset after one frame is `step`
+static void start(scanline_fx_info_t *info, int width, int effect, scanline_fx_level_t level, uint8_t step,
+                  uint8_t fade_level)
+{
+    memset(info, 0, sizeof(*info));
+    info->width = width;
+    info->height = 2;
+    info->enabled[effect] = true;
+    info->palette_step = step;
+    info->fade_level = fade_level;
+    scanline_fx_init(info);
+    info->level[effect] = level;
+    scanline_fx_begin_frame(0);
+}
+
+int main(void)
+{
+    static const int widths[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 256, 257, 259, MAX_WIDTH};
+    scanline_fx_info_t info;
+
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    {
+        int width = widths[w];
+
+        // Palette rotation at every offset; offset 0 skips the effect
+        for (int step = 0; step < 256; step++)
+        {
+            start(&info, width, SCANLINE_FX_PALETTE, SCANLINE_FX_FULL, step, 8);
+            check_row(&info, 0, OP_ROTATE, step, "palette");
+        }
+
+        // Degraded fade: nearest of unchanged, 1/2, 1/4 and black for every level
+        for (int level = 0; level <= 8; level++)
+        {
+            op_t op = level >= 7 ? OP_NONE : level >= 3 ? OP_HALF : level >= 1 ? OP_QUARTER : OP_BLACK;
+            start(&info, width, SCANLINE_FX_FADE, SCANLINE_FX_DEGRADED, 0, level);
+            check_row(&info, 0, op, 0, s_op_name[op]);
+
+            // Full fade goes through pixel_kernels_fade332
+            start(&info, width, SCANLINE_FX_FADE, SCANLINE_FX_FULL, 0, level);
+            check_row(&info, 0, level < 8 ? OP_FADE : OP_NONE, level * (PIXEL_KERNELS_ALPHA_MAX / 8), "fade");
+        }
+
+        // Darken: odd rows at half brightness, even rows untouched
+        start(&info, width, SCANLINE_FX_DARKEN, SCANLINE_FX_FULL, 0, 8);
+        check_row(&info, 0, OP_NONE, 0, "darken even");
+        check_row(&info, 1, OP_HALF, 0, "darken odd");
+    }
+
+    if (s_failures)
+    {
+        printf("%d failures\n", s_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "tile_layout.h"
+
+tile_layout_info_t *g_tile_layout_info;
+
+// Which source row a span holds; frame -1 marks a span that can't be reused
+typedef struct
+{
+    int frame;
+    uint16_t row;
+    bool mirror_x;
+} span_key_t;
+
+static uint16_t s_x_lut[TILE_LAYOUT_MAX_SIZE]; // Source column of each tile column
+static uint16_t s_y_lut[TILE_LAYOUT_MAX_SIZE]; // Source row of each tile row
+static int16_t s_tile_x[TILE_LAYOUT_MAX_TILES]; // Tile origins in the grid, offsets applied
+static int16_t s_tile_y[TILE_LAYOUT_MAX_TILES];
+static bool s_tight; // Tiles cover the whole grid: no black to clear between them
+
+// One span slot per tile, word-aligned plus the alignment of the destination it was built for
+static uint32_t s_span_words[TILE_LAYOUT_MAX_TILES][TILE_LAYOUT_MAX_SIZE / 4 + 1];
+static uint8_t *s_span[TILE_LAYOUT_MAX_TILES];
+static span_key_t s_span_key[TILE_LAYOUT_MAX_TILES];
+
+// Word copies when both sides share an alignment, which is the usual case as
+// spans are built at the alignment of the first tile they fill
+static void copy_span(uint8_t *dst, const uint8_t *src, int n)
+{
+    if ((((uintptr_t)dst ^ (uintptr_t)src) & 3) != 0)
+    {
+        memcpy(dst, src, n);
+        return;
+    }
+    while (n > 0 && ((uintptr_t)dst & 3) != 0)
+    {
+        *dst++ = *src++;
+        n--;
+    }
+    uint32_t *dst_word = (uint32_t *)dst;
+    const uint32_t *src_word = (const uint32_t *)src;
+    for (; n >= 4; n -= 4)
+    {
+        *dst_word++ = *src_word++;
+    }
+    dst = (uint8_t *)dst_word;
+    src = (const uint8_t *)src_word;
+    while (n-- > 0)
+    {
+        *dst++ = *src++;
+    }
+}
+
+static const uint8_t *find_span(int frame, uint16_t row, bool mirror_x)
+{
+    int count = g_tile_layout_info->cols * g_tile_layout_info->rows;
+    for (int i = 0; i < count; i++)
+    {
+        if (s_span_key[i].frame == frame && s_span_key[i].row == row && s_span_key[i].mirror_x == mirror_x)
+        {
+            return s_span[i];
+        }
+    }
+    return NULL;
+}
+
+// Scales source row `row` of `frame` into slot `slot`, aligned like the destination at dest_addr
+static const uint8_t *build_span(int slot, int frame, uint16_t row, bool mirror_x, int fallback_frame, uintptr_t dest_addr)
+{
+    tile_layout_info_t *info = g_tile_layout_info;
+    int n = info->tile_width;
+    uint8_t *span = (uint8_t *)s_span_words[slot] + (dest_addr & 3);
+    s_span[slot] = span;
+    s_span_key[slot].frame = frame;
+    s_span_key[slot].row = row;
+    s_span_key[slot].mirror_x = mirror_x;
+
+    const uint8_t *src = info->get_row(frame, row);
+    if (src == NULL && frame != fallback_frame)
+    {
+        src = info->get_row(fallback_frame, row);
+        s_span_key[slot].frame = -1; // Not what this frame should show once it is cached
+    }
+    if (src == NULL)
+    {
+        memset(span, 0x00, n);
+        s_span_key[slot].frame = -1;
+    }
+    else if (n == info->src_width && !mirror_x)
+    {
+        memcpy(span, src, n);
+    }
+    else if (mirror_x)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            span[x] = src[s_x_lut[n - 1 - x]];
+        }
+    }
+    else
+    {
+        for (int x = 0; x < n; x++)
+        {
+            span[x] = src[s_x_lut[x]];
+        }
+    }
+    info->spans_scaled++;
+    return span;
+}
+
+bool tile_layout_init(tile_layout_info_t *layout_info)
+{
+    g_tile_layout_info = layout_info;
+    tile_layout_info_t *info = layout_info;
+
+    int count = info->cols * info->rows;
+    int width = info->cols * info->tile_width + (info->cols - 1) * info->gap;
+    if (count < 1 || count > TILE_LAYOUT_MAX_TILES || info->src_width == 0 || info->src_height == 0 ||
+        info->tile_width == 0 || info->tile_height == 0 || info->tile_height > TILE_LAYOUT_MAX_SIZE ||
+        width > TILE_LAYOUT_MAX_SIZE)
+    {
+        printf("Tile layout: %ux%u tiles of %ux%u exceed %d tiles or %d pixels\n",
+               info->cols, info->rows, info->tile_width, info->tile_height, TILE_LAYOUT_MAX_TILES, TILE_LAYOUT_MAX_SIZE);
+        return false;
+    }
+    info->width = width;
+    info->height = info->rows * info->tile_height + (info->rows - 1) * info->gap;
+
+    for (int x = 0; x < info->tile_width; x++)
+    {
+        s_x_lut[x] = (x * info->src_width) / info->tile_width;
+    }
+    for (int y = 0; y < info->tile_height; y++)
+    {
+        s_y_lut[y] = (y * info->src_height) / info->tile_height;
+    }
+
+    s_tight = info->gap == 0;
+    for (int i = 0; i < count; i++)
+    {
+        const tile_layout_tile_t *tile = &info->tiles[i];
+        s_tile_x[i] = (i % info->cols) * (info->tile_width + info->gap) + tile->dx;
+        s_tile_y[i] = (i / info->cols) * (info->tile_height + info->gap) + tile->dy;
+        if (tile->dx != 0 || tile->dy != 0)
+        {
+            s_tight = false;
+        }
+        s_span[i] = (uint8_t *)s_span_words[i];
+        s_span_key[i].frame = -1;
+    }
+
+    tile_layout_reset_stats();
+    return true;
+}
+
+tile_layout_info_t *tile_layout_get_info(void)
+{
+    return g_tile_layout_info;
+}
+
+void tile_layout_reset_stats(void)
+{
+    tile_layout_info_t *info = g_tile_layout_info;
+    info->rows_composed = 0;
+    info->spans_scaled = 0;
+    info->spans_reused = 0;
+    info->compose_us = 0;
+}
+
+void tile_layout_compose_row(int y, int frame_index, int frame_count, uint8_t *dest)
+{
+    tile_layout_info_t *info = g_tile_layout_info;
+    uint32_t t0 = time_us_32();
+    int count = info->cols * info->rows;
+
+    if (!s_tight)
+    {
+        memset(dest, 0x00, info->width);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const tile_layout_tile_t *tile = &info->tiles[i];
+        int tile_y = y - s_tile_y[i];
+        if (tile_y < 0 || tile_y >= info->tile_height)
+        {
+            continue;
+        }
+        int x0 = s_tile_x[i];
+        int x_start = x0 > 0 ? x0 : 0;
+        int x_end = x0 + info->tile_width < info->width ? x0 + info->tile_width : info->width;
+        if (x_start >= x_end)
+        {
+            continue;
+        }
+
+        uint16_t row = s_y_lut[tile->mirror_y ? info->tile_height - 1 - tile_y : tile_y];
+        int frame = (frame_index + tile->frame_phase) % frame_count;
+        const uint8_t *span = find_span(frame, row, tile->mirror_x);
+        if (span == NULL)
+        {
+            span = build_span(i, frame, row, tile->mirror_x, frame_index, (uintptr_t)dest + x0);
+        }
+        else
+        {
+            info->spans_reused++;
+        }
+        copy_span(&dest[x_start], &span[x_start - x0], x_end - x_start);
+    }
+
+    info->rows_composed++;
+    info->compose_us += time_us_32() - t0;
+}
@@ -0,0 +1,61 @@
+#ifndef __TILE_LAYOUT_H__
+#define __TILE_LAYOUT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define TILE_LAYOUT_MAX_TILES 16
+#define TILE_LAYOUT_MAX_SIZE 480 // Largest tile side and widest grid
+
+typedef struct
+{
+    int16_t dx;           // Offset from the tile's grid cell; whatever leaves the grid is clipped
+    int16_t dy;
+    uint16_t frame_phase; // Frames ahead of the playing one, for staggered animation
+    bool mirror_x;
+    bool mirror_y;
+} tile_layout_tile_t;
+
+typedef struct
+{
+    uint16_t src_width;   // Cached frame
+    uint16_t src_height;
+    uint16_t tile_width;  // One tile after scaling
+    uint16_t tile_height;
+    uint8_t cols;
+    uint8_t rows;
+    uint16_t gap;         // Black pixels between neighbouring tiles
+    tile_layout_tile_t tiles[TILE_LAYOUT_MAX_TILES]; // Row-major; all zero is the plain grid
+    const uint8_t *(*get_row)(int frame_index, uint16_t row); // Valid until the next call
+
+    // Computed by tile_layout_init(): the grid's size, the region composed rows cover
+    uint16_t width;
+    uint16_t height;
+
+    // Statistics since the last tile_layout_reset_stats()
+    uint32_t rows_composed;
+    uint32_t spans_scaled; // Source rows scaled (and mirrored) to tile width
+    uint32_t spans_reused; // Tile spans copied from a span already scaled
+    uint32_t compose_us;
+} tile_layout_info_t;
+
+// Places cols x rows tiles in a grid (plus each tile's offset) and builds the
+// scaling tables. Call it again after changing the geometry or the offsets;
+// frame_phase and the mirror flags are read on every row. Returns false if the
+// layout doesn't fit the limits above.
+bool tile_layout_init(tile_layout_info_t *layout_info);
+tile_layout_info_t *tile_layout_get_info(void);
+
+// Composes grid row y (0..height-1) of frame_index into dest (width bytes).
+// Each source row a tile shows is scaled to tile width once, into a span that
+// is kept while following rows (vertical scaling) or other tiles on the row
+// show the same frame, row and mirroring; tiles are then filled from the spans
+// with word copies. A phased frame that isn't cached falls back to
+// frame_index, and that to black.
+void tile_layout_compose_row(int y, int frame_index, int frame_count, uint8_t *dest);
+
+void tile_layout_reset_stats(void);
+
+#endif // __TILE_LAYOUT_H__